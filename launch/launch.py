@@ -3,7 +3,8 @@ import yaml
 
 from pathlib import Path
 
-from launch_ros.actions import Node
+from launch_ros.actions import ComposableNodeContainer, Node
+from launch_ros.descriptions import ComposableNode
 from launch_ros.parameter_descriptions import ParameterFile
 from launch_ros.substitutions import FindPackageShare
 
@@ -85,6 +86,7 @@ def launch_setup():
     script_sender_port = LaunchConfiguration("script_sender_port")
     trajectory_port = LaunchConfiguration("trajectory_port")
     run_reconnect_node = LaunchConfiguration("reconnect")
+    compose = LaunchConfiguration("compose")
 
     control_node = Node(
         package="controller_manager",
@@ -417,42 +419,77 @@ def launch_setup():
         warehouse_ros_config,
     ]
 
-    coordinator_node = Node(
-        package="octa_ros",
-        executable="coordinator_node",
-        name="coordinator_node",
-        output="screen",
-        parameters=common_parameters,
-    )
+    focus_parameters = common_parameters + [
+        {
+            "image.type": "img",
+            "debug_images.mode": "off",
+            "debug_images.every_n": 1,
+            "debug_images.directory": "focus_debug",
+            "confidence.min_column": 0.02,
+            "confidence.min_frame": 0.05,
+            "bscans.max": 6,
+            "bscans.min": 3,
+            "bscans.adaptive": True,
+            "plane.max_failed_fits": 3,
+            "roi.enabled": True,
+            "roi.margin": 32,
+            "roi.min_locked_fraction": 0.6,
+        }
+    ]
 
-    freedrive_node = Node(
-        package="octa_ros",
-        executable="freedrive_node",
-        name="freedrive_node",
-        output="screen",
-        parameters=common_parameters,
-    )
+    coordinator_parameters = common_parameters + [
+        {
+            "publish.heartbeat_ms": 500,
+            "full_scan.pipelined": True,
+            # config/recipes/<name>.yaml or a path; see the load_recipe service
+            "full_scan.recipe": "default",
+        }
+    ]
 
-    focus_node = Node(
-        package="octa_ros",
-        executable="focus_node",
-        name="focus_node",
-        output="screen",
-        parameters=common_parameters,
-    )
+    # (executable / node name, component class, parameters)
+    robot_servers = [
+        ("coordinator_node", "CoordinatorNode", coordinator_parameters),
+        ("focus_node", "FocusActionServer", focus_parameters),
+        ("reset_node", "ResetActionServer", common_parameters),
+        ("move_z_angle_node", "MoveZAngleActionServer", common_parameters),
+    ]
 
-    reset_node = Node(
-        package="octa_ros",
-        executable="reset_node",
-        name="reset_node",
+    # One process, one MoveItCpp, intra-process topics between the servers.
+    robot_container = ComposableNodeContainer(
+        name="robot_container",
+        namespace="",
+        package="rclcpp_components",
+        executable="component_container_mt",
         output="screen",
-        parameters=common_parameters,
+        condition=IfCondition(compose),
+        composable_node_descriptions=[
+            ComposableNode(
+                package="octa_ros",
+                plugin=plugin,
+                name=name,
+                parameters=parameters,
+                extra_arguments=[{"use_intra_process_comms": True}],
+            )
+            for name, plugin, parameters in robot_servers
+        ],
     )
 
-    move_z_angle_node = Node(
+    robot_server_nodes = [
+        Node(
+            package="octa_ros",
+            executable=name,
+            name=name,
+            output="screen",
+            parameters=parameters,
+            condition=UnlessCondition(compose),
+        )
+        for name, _, parameters in robot_servers
+    ]
+
+    freedrive_node = Node(
         package="octa_ros",
-        executable="move_z_angle_node",
-        name="move_z_angle_node",
+        executable="freedrive_node",
+        name="freedrive_node",
         output="screen",
         parameters=common_parameters,
     )
@@ -465,12 +502,10 @@ def launch_setup():
                 move_group_node,
                 servo_node,
                 robot_state_node,
-                coordinator_node,
+                robot_container,
                 freedrive_node,
-                focus_node,
-                reset_node,
-                move_z_angle_node,
-            ],
+            ]
+            + robot_server_nodes,
         )
     )
 
@@ -491,25 +526,10 @@ def launch_setup():
         OnProcessExit(target_action=robot_state_node, on_exit=[Shutdown()])
     )
 
-    coordinator_exit_handler = RegisterEventHandler(
-        OnProcessExit(target_action=coordinator_node, on_exit=[Shutdown()])
-    )
-
-    freedrive_exit_handler = RegisterEventHandler(
-        OnProcessExit(target_action=freedrive_node, on_exit=[Shutdown()])
-    )
-
-    focus_exit_handler = RegisterEventHandler(
-        OnProcessExit(target_action=focus_node, on_exit=[Shutdown()])
-    )
-
-    reset_exit_handler = RegisterEventHandler(
-        OnProcessExit(target_action=reset_node, on_exit=[Shutdown()])
-    )
-
-    move_z_angle_exit_handler = RegisterEventHandler(
-        OnProcessExit(target_action=move_z_angle_node, on_exit=[Shutdown()])
-    )
+    robot_exit_handlers = [
+        RegisterEventHandler(OnProcessExit(target_action=action, on_exit=[Shutdown()]))
+        for action in [robot_container, freedrive_node] + robot_server_nodes
+    ]
 
     nodes_to_start = (
         [
@@ -525,14 +545,8 @@ def launch_setup():
         ]
         + controller_spawners
         + [nodes_after_driver]
-        + [
-            joint_publisher_exit_handler,
-            coordinator_exit_handler,
-            freedrive_exit_handler,
-            focus_exit_handler,
-            reset_exit_handler,
-            move_z_angle_exit_handler,
-        ]
+        + [joint_publisher_exit_handler]
+        + robot_exit_handlers
         + [reconnect_client_action]
     )
 
@@ -671,6 +685,17 @@ def generate_launch_description():
             ],
         )
     )
+    declared_arguments.append(
+        DeclareLaunchArgument(
+            "compose",
+            description="Run the MoveIt action servers as components in one process",
+            default_value="true",
+            choices=[
+                "true",
+                "false",
+            ],
+        )
+    )
     declared_arguments.append(
         DeclareLaunchArgument(
             "tf_prefix",
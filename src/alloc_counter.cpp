@@ -0,0 +1,39 @@
+#include "alloc_counter.hpp"
+
+#ifdef OCTA_COUNT_ALLOCATIONS
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local std::uint64_t allocation_count = 0;
+
+void *counted_alloc(std::size_t size) {
+    ++allocation_count;
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void *operator new(std::size_t size) { return counted_alloc(size); }
+void *operator new[](std::size_t size) { return counted_alloc(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+std::optional<std::uint64_t> thread_allocation_count() {
+    return allocation_count;
+}
+
+#else
+
+std::optional<std::uint64_t> thread_allocation_count() {
+    return std::nullopt;
+}
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef ALLOC_COUNTER_HPP
+#define ALLOC_COUNTER_HPP
+
+#include <cstdint>
+#include <optional>
+
+// Number of global operator new calls made by the calling thread. The count
+// is only maintained when built with OCTA_COUNT_ALLOCATIONS, which replaces
+// the global allocation functions; otherwise nothing is counted and this
+// returns nullopt.
+std::optional<std::uint64_t> thread_allocation_count();
+
+#endif // ALLOC_COUNTER_HPP
@@ -0,0 +1,52 @@
+#include "background_logger.hpp"
+
+#include <rclcpp/logging.hpp>
+
+BackgroundLogger::BackgroundLogger(rclcpp::Logger logger,
+                                   std::size_t queue_depth)
+    : logger_(std::move(logger)), queue_depth_(queue_depth) {
+    thread_ = std::thread([this]() { run(); });
+}
+
+BackgroundLogger::~BackgroundLogger() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool BackgroundLogger::post(Format format) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.size() >= queue_depth_) {
+            dropped_.fetch_add(1);
+            return false;
+        }
+        queue_.push_back(std::move(format));
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void BackgroundLogger::run() {
+    while (true) {
+        Format format;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            format = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        std::string line = format();
+        if (!line.empty()) {
+            RCLCPP_INFO(logger_, "%s", line.c_str());
+        }
+    }
+}
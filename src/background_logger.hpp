@@ -0,0 +1,54 @@
+#ifndef BACKGROUND_LOGGER_HPP
+#define BACKGROUND_LOGGER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <rclcpp/logger.hpp>
+
+// Formats and emits log lines on a background thread. post() only queues a
+// closure, which is run on the logger thread and logged at INFO if it
+// returns a non-empty string, so building diffs of large messages stays off
+// the callback path. When the queue is full the line is dropped.
+//
+// Closures must capture what they format by value.
+class BackgroundLogger {
+  public:
+    using Format = std::function<std::string()>;
+
+    explicit BackgroundLogger(rclcpp::Logger logger,
+                              std::size_t queue_depth = 64);
+    ~BackgroundLogger();
+
+    BackgroundLogger(const BackgroundLogger &) = delete;
+    BackgroundLogger &operator=(const BackgroundLogger &) = delete;
+
+    // Returns false if the line was dropped.
+    bool post(Format format);
+
+    std::uint64_t dropped() const { return dropped_.load(); }
+
+  private:
+    void run();
+
+    rclcpp::Logger logger_;
+    const std::size_t queue_depth_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Format> queue_;
+    bool stop_ = false;
+
+    std::atomic<std::uint64_t> dropped_{0};
+
+    std::thread thread_;
+};
+
+#endif // BACKGROUND_LOGGER_HPP
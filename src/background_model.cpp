@@ -0,0 +1,40 @@
+#include "background_model.hpp"
+
+#include <ament_index_cpp/get_package_share_directory.hpp>
+
+BackgroundModel &BackgroundModel::instance() {
+    static BackgroundModel model;
+    return model;
+}
+
+std::string BackgroundModel::default_path() {
+    std::string pkg_share =
+        ament_index_cpp::get_package_share_directory("octa_ros");
+    return pkg_share + "/config/bg.jpg";
+}
+
+bool BackgroundModel::load(const std::string &path) {
+    cv::Mat bg = cv::imread(path, cv::IMREAD_GRAYSCALE);
+    if (bg.empty()) {
+        return false;
+    }
+    update(bg);
+    return true;
+}
+
+void BackgroundModel::update(const cv::Mat &bg) {
+    CV_Assert(!bg.empty());
+    cv::Mat gray;
+    if (bg.channels() == 3) {
+        cv::cvtColor(bg, gray, cv::COLOR_BGR2GRAY);
+    } else {
+        gray = bg;
+    }
+    auto bg_f = std::make_shared<cv::Mat>();
+    gray.convertTo(*bg_f, CV_32F);
+    bg_f_.store(std::move(bg_f), std::memory_order_release);
+}
+
+std::shared_ptr<const cv::Mat> BackgroundModel::get() const {
+    return bg_f_.load(std::memory_order_acquire);
+}
@@ -0,0 +1,35 @@
+#ifndef BACKGROUND_MODEL_HPP
+#define BACKGROUND_MODEL_HPP
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include <opencv2/opencv.hpp>
+
+// Background frame used by bg_sub(), decoded once and kept as CV_32F.
+// Readers get an immutable snapshot; update() swaps in a new one atomically so
+// detection running on other threads never sees a half-written background.
+//
+// Only load() reads the filesystem, and only when its owner asks: get() is on
+// the detection path and just returns the current snapshot, which is empty
+// until a load() or update() has succeeded.
+class BackgroundModel {
+  public:
+    static BackgroundModel &instance();
+
+    static std::string default_path();
+
+    // Returns false, keeping the current background, if `path` cannot be
+    // read as an image. Reporting the failure is up to the caller.
+    bool load(const std::string &path);
+    void update(const cv::Mat &bg);
+    std::shared_ptr<const cv::Mat> get() const;
+
+  private:
+    BackgroundModel() = default;
+
+    std::atomic<std::shared_ptr<const cv::Mat>> bg_f_;
+};
+
+#endif // BACKGROUND_MODEL_HPP
@@ -0,0 +1,44 @@
+#include "bscan_selector.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+BscanSelector::BscanSelector(int slots)
+    : slots_(std::max(2, slots)), taken_(slots_, 0) {}
+
+void BscanSelector::reset() {
+    std::fill(taken_.begin(), taken_.end(), 0);
+    taken_count_ = 0;
+}
+
+int BscanSelector::slot(int bscan_index, int bscan_count) const {
+    if (bscan_count < slots_ || bscan_index < 0 ||
+        bscan_index >= bscan_count) {
+        return -1;
+    }
+    // Nearest slot, then check that the slot's position rounds back to this
+    // index, so exactly one index per slot matches.
+    double step = static_cast<double>(bscan_count - 1) / (slots_ - 1);
+    int slot = static_cast<int>(std::lround(bscan_index / step));
+    if (static_cast<int>(std::lround(slot * step)) != bscan_index) {
+        return -1;
+    }
+    return slot;
+}
+
+int BscanSelector::take(int bscan_index, int bscan_count) {
+    int s = slot(bscan_index, bscan_count);
+    if (s < 0 || taken_[s]) {
+        return -1;
+    }
+    taken_[s] = 1;
+    ++taken_count_;
+    return s;
+}
+
+double bscan_position(int bscan_index, int bscan_count) {
+    if (bscan_count < 2) {
+        return 0.0;
+    }
+    return bscan_index * 499.0 / static_cast<double>(bscan_count - 1);
+}
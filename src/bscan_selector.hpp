@@ -0,0 +1,41 @@
+#ifndef BSCAN_SELECTOR_HPP
+#define BSCAN_SELECTOR_HPP
+
+#include <cstdint>
+#include <vector>
+
+// Picks the B-scans of a volume that one focus acquisition needs: `slots`
+// positions evenly spread over the slow axis, first and last included. Frames
+// are matched on the B-scan index the acquisition side reports, so each
+// wanted position is taken the moment it arrives and nothing else is kept.
+class BscanSelector {
+  public:
+    explicit BscanSelector(int slots);
+
+    int slots() const { return slots_; }
+
+    // Forget what has been taken, e.g. for a new acquisition.
+    void reset();
+
+    // Slot B-scan `bscan_index` of `bscan_count` belongs to, or -1 if the
+    // position is not wanted. Depends only on the slot count, so it is safe
+    // to call while another thread takes slots.
+    int slot(int bscan_index, int bscan_count) const;
+    // As slot(), but also -1 if the slot was already taken; a returned slot
+    // counts as taken.
+    int take(int bscan_index, int bscan_count);
+
+    bool complete() const { return taken_count_ == slots_; }
+    int taken() const { return taken_count_; }
+
+  private:
+    int slots_;
+    std::vector<std::uint8_t> taken_;
+    int taken_count_ = 0;
+};
+
+// Slow-axis position, in the 0..499 pixel units of the focus point cloud, of
+// B-scan `bscan_index` in a volume of `bscan_count`.
+double bscan_position(int bscan_index, int bscan_count);
+
+#endif // BSCAN_SELECTOR_HPP
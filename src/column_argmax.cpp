@@ -0,0 +1,295 @@
+#include "column_argmax.hpp"
+#include "simd.hpp"
+
+namespace {
+
+constexpr int kScalarBlock = 64;
+
+// 8-bit sums stay exact in 16-bit lanes for this many rows.
+constexpr int kSumBatch = 257;
+
+// (peak - column mean) / 255 from the peak value and column sum.
+inline float column_confidence(int peak, std::uint32_t sum, int rows) {
+    return (static_cast<float>(peak) -
+            static_cast<float>(sum) / static_cast<float>(rows)) /
+           255.0f;
+}
+
+// Remaining columns: same row sweep with the block state on the stack.
+void argmax_block_scalar(const std::uint8_t *src, std::size_t step, int c0,
+                         int width, int row_begin, int row_end,
+                         int *peak_rows, float *confidence) {
+    std::uint8_t best[kScalarBlock];
+    int idx[kScalarBlock];
+    std::uint32_t sum[kScalarBlock];
+    const std::uint8_t *first = src + row_begin * step + c0;
+    for (int i = 0; i < width; ++i) {
+        best[i] = first[i];
+        idx[i] = row_begin;
+        sum[i] = first[i];
+    }
+    for (int r = row_begin + 1; r < row_end; ++r) {
+        const std::uint8_t *p = src + r * step + c0;
+        for (int i = 0; i < width; ++i) {
+            if (p[i] > best[i]) {
+                best[i] = p[i];
+                idx[i] = r;
+            }
+            sum[i] += p[i];
+        }
+    }
+    for (int i = 0; i < width; ++i) {
+        peak_rows[c0 + i] = idx[i];
+    }
+    if (confidence) {
+        for (int i = 0; i < width; ++i) {
+            confidence[c0 + i] =
+                column_confidence(best[i], sum[i], row_end - row_begin);
+        }
+    }
+}
+
+#if defined(OCTA_SIMD_AVX2)
+
+// NV vectors of 16 columns each, widened to 16-bit so the comparison and the
+// row index share lanes. With Conf the column sums ride along in 16-bit lanes
+// and are flushed to 32-bit every kSumBatch rows.
+template <int NV, bool Conf>
+void argmax_block(const std::uint8_t *src, std::size_t step, int c0,
+                  int row_begin, int row_end, int *peak_rows,
+                  float *confidence) {
+    __m256i best[NV];
+    __m256i idx[NV];
+    __m256i sum[NV];
+    alignas(32) std::uint32_t acc[NV * 16] = {};
+    auto flush = [&]() {
+        for (int k = 0; k < NV; ++k) {
+            __m256i *a = reinterpret_cast<__m256i *>(acc + 16 * k);
+            a[0] = _mm256_add_epi32(
+                a[0], _mm256_cvtepu16_epi32(_mm256_castsi256_si128(sum[k])));
+            a[1] = _mm256_add_epi32(
+                a[1],
+                _mm256_cvtepu16_epi32(_mm256_extracti128_si256(sum[k], 1)));
+            sum[k] = _mm256_setzero_si256();
+        }
+    };
+
+    const std::uint8_t *first = src + row_begin * step + c0;
+    for (int k = 0; k < NV; ++k) {
+        best[k] = _mm256_cvtepu8_epi16(_mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(first + 16 * k)));
+        idx[k] = _mm256_set1_epi16(static_cast<short>(row_begin));
+        sum[k] = best[k];
+    }
+    int batch = 1;
+    for (int r = row_begin + 1; r < row_end; ++r) {
+        const std::uint8_t *p = src + r * step + c0;
+        const __m256i row = _mm256_set1_epi16(static_cast<short>(r));
+        for (int k = 0; k < NV; ++k) {
+            __m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(p + 16 * k)));
+            __m256i gt = _mm256_cmpgt_epi16(v, best[k]);
+            best[k] = _mm256_max_epi16(v, best[k]);
+            idx[k] = _mm256_blendv_epi8(idx[k], row, gt);
+            if constexpr (Conf) {
+                sum[k] = _mm256_add_epi16(sum[k], v);
+            }
+        }
+        if constexpr (Conf) {
+            if (++batch == kSumBatch) {
+                flush();
+                batch = 0;
+            }
+        }
+    }
+    for (int k = 0; k < NV; ++k) {
+        int *out = peak_rows + c0 + 16 * k;
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i *>(out),
+            _mm256_cvtepu16_epi32(_mm256_castsi256_si128(idx[k])));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i *>(out + 8),
+            _mm256_cvtepu16_epi32(_mm256_extracti128_si256(idx[k], 1)));
+    }
+    if constexpr (Conf) {
+        flush();
+        alignas(32) std::uint16_t peak[NV * 16];
+        for (int k = 0; k < NV; ++k) {
+            _mm256_store_si256(reinterpret_cast<__m256i *>(peak + 16 * k),
+                               best[k]);
+        }
+        for (int i = 0; i < NV * 16; ++i) {
+            confidence[c0 + i] =
+                column_confidence(peak[i], acc[i], row_end - row_begin);
+        }
+    }
+}
+
+constexpr int kWideBlock = 64;
+constexpr int kNarrowBlock = 16;
+
+#elif defined(OCTA_SIMD_NEON)
+
+// NV vectors of 8 columns each, widened to 16-bit; column sums as above.
+template <int NV, bool Conf>
+void argmax_block(const std::uint8_t *src, std::size_t step, int c0,
+                  int row_begin, int row_end, int *peak_rows,
+                  float *confidence) {
+    uint16x8_t best[NV];
+    uint16x8_t idx[NV];
+    uint16x8_t sum[NV];
+    std::uint32_t acc[NV * 8] = {};
+    auto flush = [&]() {
+        for (int k = 0; k < NV; ++k) {
+            std::uint32_t *a = acc + 8 * k;
+            vst1q_u32(a, vaddw_u16(vld1q_u32(a), vget_low_u16(sum[k])));
+            vst1q_u32(a + 4,
+                      vaddw_u16(vld1q_u32(a + 4), vget_high_u16(sum[k])));
+            sum[k] = vdupq_n_u16(0);
+        }
+    };
+
+    const std::uint8_t *first = src + row_begin * step + c0;
+    for (int k = 0; k < NV; ++k) {
+        best[k] = vmovl_u8(vld1_u8(first + 8 * k));
+        idx[k] = vdupq_n_u16(static_cast<std::uint16_t>(row_begin));
+        sum[k] = best[k];
+    }
+    int batch = 1;
+    for (int r = row_begin + 1; r < row_end; ++r) {
+        const std::uint8_t *p = src + r * step + c0;
+        const uint16x8_t row = vdupq_n_u16(static_cast<std::uint16_t>(r));
+        for (int k = 0; k < NV; ++k) {
+            uint16x8_t v = vmovl_u8(vld1_u8(p + 8 * k));
+            uint16x8_t gt = vcgtq_u16(v, best[k]);
+            best[k] = vmaxq_u16(v, best[k]);
+            idx[k] = vbslq_u16(gt, row, idx[k]);
+            if constexpr (Conf) {
+                sum[k] = vaddq_u16(sum[k], v);
+            }
+        }
+        if constexpr (Conf) {
+            if (++batch == kSumBatch) {
+                flush();
+                batch = 0;
+            }
+        }
+    }
+    for (int k = 0; k < NV; ++k) {
+        int *out = peak_rows + c0 + 8 * k;
+        vst1q_s32(out, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(idx[k]))));
+        vst1q_s32(out + 4,
+                  vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(idx[k]))));
+    }
+    if constexpr (Conf) {
+        flush();
+        std::uint16_t peak[NV * 8];
+        for (int k = 0; k < NV; ++k) {
+            vst1q_u16(peak + 8 * k, best[k]);
+        }
+        for (int i = 0; i < NV * 8; ++i) {
+            confidence[c0 + i] =
+                column_confidence(peak[i], acc[i], row_end - row_begin);
+        }
+    }
+}
+
+constexpr int kWideBlock = 32;
+constexpr int kNarrowBlock = 8;
+
+#endif
+
+} // namespace
+
+namespace {
+
+template <bool Conf>
+void column_sweep(const std::uint8_t *src, std::size_t step, int cols,
+                  int row_begin, int row_end, int *peak_rows,
+                  float *confidence) {
+    int c = 0;
+#if defined(OCTA_SIMD_AVX2) || defined(OCTA_SIMD_NEON)
+    for (; c + kWideBlock <= cols; c += kWideBlock) {
+        argmax_block<kWideBlock / kNarrowBlock, Conf>(
+            src, step, c, row_begin, row_end, peak_rows, confidence);
+    }
+    for (; c + kNarrowBlock <= cols; c += kNarrowBlock) {
+        argmax_block<1, Conf>(src, step, c, row_begin, row_end, peak_rows,
+                              confidence);
+    }
+#endif
+    for (; c < cols; c += kScalarBlock) {
+        argmax_block_scalar(src, step, c, std::min(kScalarBlock, cols - c),
+                            row_begin, row_end, peak_rows, confidence);
+    }
+}
+
+} // namespace
+
+void column_argmax_u8(const std::uint8_t *src, std::size_t step, int cols,
+                      int row_begin, int row_end, int *peak_rows,
+                      float *confidence) {
+    if (confidence) {
+        column_sweep<true>(src, step, cols, row_begin, row_end, peak_rows,
+                           confidence);
+    } else {
+        column_sweep<false>(src, step, cols, row_begin, row_end, peak_rows,
+                            nullptr);
+    }
+}
+
+void column_argmax(const cv::Mat &img, std::span<int> peak_rows,
+                   int row_begin, int row_end) {
+    column_argmax(img, peak_rows, {}, row_begin, row_end);
+}
+
+void column_argmax(const cv::Mat &img, std::span<int> peak_rows,
+                   std::span<float> confidence, int row_begin, int row_end) {
+    CV_Assert(!img.empty() && img.type() == CV_8UC1);
+    CV_Assert(peak_rows.size() == static_cast<std::size_t>(img.cols));
+    CV_Assert(confidence.empty() ||
+              confidence.size() == static_cast<std::size_t>(img.cols));
+    CV_Assert(img.rows <= 0xFFFF);
+    if (row_end < 0 || row_end > img.rows) {
+        row_end = img.rows;
+    }
+    row_begin = std::clamp(row_begin, 0, row_end - 1);
+
+    column_argmax_u8(img.ptr<std::uint8_t>(), img.step, img.cols, row_begin,
+                     row_end, peak_rows.data(),
+                     confidence.empty() ? nullptr : confidence.data());
+}
+
+void column_argmax_banded(const cv::Mat &img, std::span<const int> lo,
+                          std::span<const int> hi, std::span<int> peak_rows,
+                          std::span<float> confidence,
+                          std::span<const float> column_mean) {
+    CV_Assert(!img.empty() && img.type() == CV_8UC1);
+    const std::size_t cols = static_cast<std::size_t>(img.cols);
+    CV_Assert(lo.size() == cols && hi.size() == cols &&
+              peak_rows.size() == cols);
+    CV_Assert(confidence.empty() ||
+              (confidence.size() == cols && column_mean.size() == cols));
+
+    const std::uint8_t *src = img.ptr<std::uint8_t>();
+    for (int x = 0; x < img.cols; ++x) {
+        const int begin = lo[x];
+        const int end = hi[x];
+        CV_DbgAssert(0 <= begin && begin < end && end <= img.rows);
+        int best = -1;
+        int idx = begin;
+        for (int r = begin; r < end; ++r) {
+            int v = src[r * img.step + x];
+            if (v > best) {
+                best = v;
+                idx = r;
+            }
+        }
+        peak_rows[x] = idx;
+        if (!confidence.empty()) {
+            // As column_confidence(), with the mean it would compute.
+            confidence[x] =
+                (static_cast<float>(best) - column_mean[x]) / 255.0f;
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef COLUMN_ARGMAX_HPP
+#define COLUMN_ARGMAX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include <opencv2/opencv.hpp>
+
+// Row of the maximum of every column of an 8-bit image, searched over rows
+// [row_begin, row_end). The image is swept top to bottom in blocks of
+// columns whose running max and row index stay in vector registers. Ties
+// resolve to the top-most row, matching cv::minMaxLoc on img.col(x).
+//
+// If `confidence` is not null the same sweep also accumulates the column sums
+// and writes (peak - column mean) / 255 per column, a contrast measure in
+// [0, 1] that is high for a sharp surface return and low for noise.
+void column_argmax_u8(const std::uint8_t *src, std::size_t step, int cols,
+                      int row_begin, int row_end, int *peak_rows,
+                      float *confidence = nullptr);
+
+// `img` must be CV_8UC1 and `peak_rows` hold img.cols entries. A negative
+// row_end means the full image height.
+void column_argmax(const cv::Mat &img, std::span<int> peak_rows,
+                   int row_begin = 0, int row_end = -1);
+void column_argmax(const cv::Mat &img, std::span<int> peak_rows,
+                   std::span<float> confidence, int row_begin = 0,
+                   int row_end = -1);
+
+// Per-column search window: column x is searched over rows [lo[x], hi[x]),
+// which must be non-empty and inside the image. Written as a plain column
+// walk since the bands are only a few dozen rows tall. `confidence` is
+// optional, as above; a band does not see its whole column, so the column
+// means come from `column_mean` (e.g. those of the last full frame), which
+// must then hold img.cols entries.
+void column_argmax_banded(const cv::Mat &img, std::span<const int> lo,
+                          std::span<const int> hi, std::span<int> peak_rows,
+                          std::span<float> confidence,
+                          std::span<const float> column_mean = {});
+
+#endif // COLUMN_ARGMAX_HPP
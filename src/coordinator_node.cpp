@@ -10,18 +10,23 @@
 #include <atomic>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <format>
-#include <future>
-#include <mutex>
+#include <memory>
+#include <optional>
+#include <sstream>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <vector>
 
 #include <std_msgs/msg/bool.hpp>
 
 #include <action_msgs/msg/goal_status.hpp>
+#include <ament_index_cpp/get_package_share_directory.hpp>
 #include <rclcpp/rclcpp.hpp>
 #include <rclcpp_action/rclcpp_action.hpp>
+#include <rclcpp_components/register_node_macro.hpp>
 
 #include <moveit/moveit_cpp/moveit_cpp.hpp>
 #include <moveit/planning_scene_interface/planning_scene_interface.hpp>
@@ -29,96 +34,104 @@
 
 #include <octa_ros/msg/labviewdata.hpp>
 #include <octa_ros/msg/robotdata.hpp>
+#include <octa_ros/msg/status_entry.hpp>
 
 #include <octa_ros/action/focus.hpp>
 #include <octa_ros/action/freedrive.hpp>
 #include <octa_ros/action/move_z_angle.hpp>
 #include <octa_ros/action/reset.hpp>
 
+#include <octa_ros/srv/load_recipe.hpp>
 #include <octa_ros/srv/scan3d.hpp>
 #include <std_srvs/srv/trigger.hpp>
 
+#include "background_logger.hpp"
+#include "moveit_shared.hpp"
+#include "scan_pipeline.hpp"
+#include "scan_recipe.hpp"
+#include "seqlock.hpp"
+#include "status_log.hpp"
 #include "utils.hpp"
 
 using namespace std::chrono_literals;
 
-enum class UserAction {
-    None,
-    Freedrive,
-    Reset,
-    MoveZangle,
-    Focus,
-    Scan,
-};
-
-enum class Mode {
-    ROBOT,
-    OCT,
-    OCTA,
-    OCE,
-};
-
 enum class ScanState {
     IDLE,
     BUSY,
 };
 
-struct Step {
-    UserAction action;
-    Mode mode;
-    double arg;
+// What woke the coordinator up. There is no polling loop: the state machine
+// only advances when one of these happens.
+enum class Event {
+    Command,      // labview_data arrived
+    Cancel,       // cancel_current_action arrived
+    GoalResponse, // an action server accepted or rejected a goal
+    GoalResult,   // an action finished
+    ConfigPulse,  // the apply_config pulse ran out
+    Scan3d,       // the scan_3d service was called
 };
 
-const std::vector<Step> full_scan_recipe = {
-    {UserAction::Focus, Mode::ROBOT, 0},
-    // initial OCTA
-    {UserAction::Scan, Mode::OCTA, 0},
-    {UserAction::Scan, Mode::OCE, 0},
-    // first 60 deg
-    {UserAction::MoveZangle, Mode::OCE, +10},
-    {UserAction::Scan, Mode::OCE, 0},
-    {UserAction::MoveZangle, Mode::OCE, +10},
-    {UserAction::Scan, Mode::OCE, 0},
-    {UserAction::MoveZangle, Mode::OCE, +10},
-    {UserAction::Scan, Mode::OCE, 0},
-    {UserAction::MoveZangle, Mode::OCE, +10},
-    {UserAction::Scan, Mode::OCE, 0},
-    {UserAction::MoveZangle, Mode::OCE, +10},
-    {UserAction::Scan, Mode::OCE, 0},
-    {UserAction::MoveZangle, Mode::OCE, +10},
-    {UserAction::Scan, Mode::OCE, 0},
-    // intermediate OCT scans
-    {UserAction::Scan, Mode::OCT, 0},
-    // second 60 deg
-    {UserAction::MoveZangle, Mode::OCE, +10},
-    {UserAction::Scan, Mode::OCE, 0},
-    {UserAction::MoveZangle, Mode::OCE, +10},
-    {UserAction::Scan, Mode::OCE, 0},
-    {UserAction::MoveZangle, Mode::OCE, +10},
-    {UserAction::Scan, Mode::OCE, 0},
-    {UserAction::MoveZangle, Mode::OCE, +10},
-    {UserAction::Scan, Mode::OCE, 0},
-    {UserAction::MoveZangle, Mode::OCE, +10},
-    {UserAction::Scan, Mode::OCE, 0},
-    {UserAction::MoveZangle, Mode::OCE, +10},
-    {UserAction::Scan, Mode::OCE, 0},
-    // intermediate OCT scans
-    {UserAction::Scan, Mode::OCT, 0},
-    // third 60 deg
-    {UserAction::MoveZangle, Mode::OCE, +10},
-    {UserAction::Scan, Mode::OCE, 0},
-    {UserAction::MoveZangle, Mode::OCE, +10},
-    {UserAction::Scan, Mode::OCE, 0},
-    {UserAction::MoveZangle, Mode::OCE, +10},
-    {UserAction::Scan, Mode::OCE, 0},
-    {UserAction::MoveZangle, Mode::OCE, +10},
-    {UserAction::Scan, Mode::OCE, 0},
-    {UserAction::MoveZangle, Mode::OCE, +10},
-    {UserAction::Scan, Mode::OCE, 0},
-    {UserAction::MoveZangle, Mode::OCE, +10},
-    {UserAction::Scan, Mode::OCE, 0},
-    // final OCT scans
-    {UserAction::Scan, Mode::OCT, 0},
+inline const char *to_string(Event event) {
+    switch (event) {
+    case Event::Command:
+        return "command";
+    case Event::Cancel:
+        return "cancel";
+    case Event::GoalResponse:
+        return "goal response";
+    case Event::GoalResult:
+        return "goal result";
+    case Event::ConfigPulse:
+        return "config pulse";
+    case Event::Scan3d:
+        return "scan_3d";
+    }
+    return "?";
+}
+
+inline const char *to_string(UserAction action) {
+    switch (action) {
+    case UserAction::None:
+        return "None";
+    case UserAction::Freedrive:
+        return "Freedrive";
+    case UserAction::Reset:
+        return "Reset";
+    case UserAction::MoveZangle:
+        return "MoveZangle";
+    case UserAction::Focus:
+        return "Focus";
+    case UserAction::Scan:
+        return "Scan";
+    }
+    return "?";
+}
+
+// Everything in Robotdata but the status entries, packed so the heartbeat
+// can copy it without a lock. `status` is the sequence number of the newest
+// status entry; the entries themselves are shared separately.
+struct RobotState {
+    double angle = 0.0;
+    std::uint64_t status = 0;
+    std::int32_t circle_state = 0;
+    bool scan_trigger = false;
+    bool apply_config = false;
+    bool end_state = false;
+    bool scan_3d = false;
+    bool full_scan = false;
+    bool robot_mode = false;
+    bool oct_mode = false;
+    bool octa_mode = false;
+    bool oce_mode = false;
+
+    bool operator==(const RobotState &) const = default;
+};
+
+// The part of the status log that goes into Robotdata.
+struct StatusWindow {
+    std::string newest;
+    // A bounded sequence in the message, not a std::vector.
+    octa_ros::msg::Robotdata::_status_type entries;
 };
 
 class CoordinatorNode : public rclcpp::Node {
@@ -129,6 +142,7 @@ class CoordinatorNode : public rclcpp::Node {
     using Reset = octa_ros::action::Reset;
 
     using Scan3d = octa_ros::srv::Scan3d;
+    using LoadRecipe = octa_ros::srv::LoadRecipe;
 
     using FocusGoalHandle = rclcpp_action::ClientGoalHandle<FocusAction>;
     using MoveZGoalHandle = rclcpp_action::ClientGoalHandle<MoveZAngle>;
@@ -139,7 +153,14 @@ class CoordinatorNode : public rclcpp::Node {
         const rclcpp::NodeOptions &options = rclcpp::NodeOptions())
         : Node("coordinator_node",
                rclcpp::NodeOptions(options)
-                   .automatically_declare_parameters_from_overrides(true)) {}
+                   .automatically_declare_parameters_from_overrides(true)) {
+        // init() needs shared_from_this(), which is only valid once the
+        // node is owned by the container or the generated main().
+        init_timer_ = create_wall_timer(0s, [this]() {
+            init_timer_->cancel();
+            init();
+        });
+    }
 
     void init() {
         {
@@ -169,9 +190,14 @@ class CoordinatorNode : public rclcpp::Node {
                 std::bind(&CoordinatorNode::scan3dCallback, this,
                           std::placeholders::_1, std::placeholders::_2));
         }
+        {
+            load_recipe_srv_ = create_service<LoadRecipe>(
+                "load_recipe",
+                std::bind(&CoordinatorNode::loadRecipeCallback, this,
+                          std::placeholders::_1, std::placeholders::_2));
+        }
 
-        moveit_cpp_ =
-            std::make_shared<moveit_cpp::MoveItCpp>(shared_from_this());
+        moveit_cpp_ = shared_moveit_cpp(shared_from_this());
 
         moveit_msgs::msg::CollisionObject collision_floor;
         collision_floor.header.frame_id = moveit_cpp_->getPlanningSceneMonitor()
@@ -248,10 +274,6 @@ class CoordinatorNode : public rclcpp::Node {
 
         RCLCPP_INFO(get_logger(), "Collision objects added to planning scene.");
 
-        pub_timer_ = this->create_wall_timer(
-            std::chrono::milliseconds(5),
-            std::bind(&CoordinatorNode::publisherCallback, this));
-
         focus_action_client_ =
             rclcpp_action::create_client<FocusAction>(this, "focus_action");
         move_z_angle_action_client_ = rclcpp_action::create_client<MoveZAngle>(
@@ -264,10 +286,6 @@ class CoordinatorNode : public rclcpp::Node {
         service_capture_background_ =
             create_client<std_srvs::srv::Trigger>("capture_background");
 
-        main_loop_timer_ = this->create_wall_timer(
-            std::chrono::milliseconds(5),
-            std::bind(&CoordinatorNode::mainLoop, this));
-
         if (!focus_action_client_->wait_for_action_server(
                 std::chrono::milliseconds(200))) {
             RCLCPP_WARN(get_logger(), "Focus action server not available yet.");
@@ -287,6 +305,35 @@ class CoordinatorNode : public rclcpp::Node {
             RCLCPP_WARN(get_logger(), "Reset action server not available yet.");
         }
 
+        pipelined_ = get_parameter_or<bool>("full_scan.pipelined", true);
+        try {
+            load_recipe(get_parameter_or<std::string>("full_scan.recipe",
+                                                      "default"));
+        } catch (const std::exception &e) {
+            status("recipe", StatusLog::Level::Error,
+                   std::format("No full-scan recipe: {}", e.what()));
+        }
+
+        {
+            // 0 (or less) turns the heartbeat off; a minute is the longest
+            // period that still tells the GUI the coordinator is alive.
+            const std::int64_t heartbeat_ms = std::clamp<std::int64_t>(
+                get_parameter_or<int64_t>("publish.heartbeat_ms", 500), 0,
+                60000);
+            heartbeat_period_ns_ = heartbeat_ms * 1000000;
+            if (heartbeat_ms > 0) {
+                heartbeat_group_ = create_callback_group(
+                    rclcpp::CallbackGroupType::MutuallyExclusive);
+                heartbeat_timer_ = create_wall_timer(
+                    std::chrono::milliseconds(heartbeat_ms),
+                    [this]() { heartbeat(); }, heartbeat_group_);
+            }
+        }
+
+        // Nothing is published until the first event otherwise.
+        info("idle");
+        publishState();
+
         RCLCPP_INFO(get_logger(), "Coordinator Node Initialized.");
     }
 
@@ -299,6 +346,7 @@ class CoordinatorNode : public rclcpp::Node {
     rclcpp::Client<std_srvs::srv::Trigger>::SharedPtr
         service_capture_background_;
 
+    rclcpp::TimerBase::SharedPtr init_timer_;
     moveit_cpp::MoveItCppPtr moveit_cpp_;
     moveit::planning_interface::PlanningSceneInterface psi;
 
@@ -307,9 +355,7 @@ class CoordinatorNode : public rclcpp::Node {
     rclcpp::Subscription<std_msgs::msg::Bool>::SharedPtr cancel_handle_;
 
     rclcpp::Service<Scan3d>::SharedPtr scan_3d_srv_;
-
-    rclcpp::TimerBase::SharedPtr pub_timer_;
-    rclcpp::TimerBase::SharedPtr main_loop_timer_;
+    rclcpp::Service<LoadRecipe>::SharedPtr load_recipe_srv_;
 
     FocusGoalHandle::SharedPtr active_focus_goal_handle_;
     MoveZGoalHandle::SharedPtr active_move_z_goal_handle_;
@@ -320,16 +366,20 @@ class CoordinatorNode : public rclcpp::Node {
     UserAction current_action_ = UserAction::None;
     UserAction previous_action_ = UserAction::None;
     octa_ros::msg::Labviewdata old_sub_msg_;
-    octa_ros::msg::Robotdata old_pub_msg_;
     double roll_ = 0.0;
     double pitch_ = 0.0;
     double yaw_ = 0.0;
     double angle_increment_ = 0.0;
-    std::mutex data_mutex_;
     rclcpp::Time start;
     bool scan_trigger_store_ = false;
     bool success_ = false;
-    std::atomic<unsigned int> pc_ = 0;
+    // The running full scan, kept after it finishes or fails until LabVIEW
+    // clears full_scan so it does not start over.
+    std::unique_ptr<ScanPipeline> pipeline_;
+    bool pipelined_ = true;
+    // The compiled recipe full scans run. Only replaced while no full scan
+    // holds it.
+    std::optional<ScanPlan> plan_;
     std::atomic<ScanState> scan_state_ = ScanState::IDLE;
 
     rclcpp::TimerBase::SharedPtr config_timer_;
@@ -337,12 +387,27 @@ class CoordinatorNode : public rclcpp::Node {
     rclcpp::TimerBase::SharedPtr scan_timer_;
     std::weak_ptr<rclcpp::TimerBase> scan_timer_weak_;
 
+    // Robotdata publishing. The state is written only on the callback path
+    // (publishState) and read by the heartbeat.
+    Seqlock<RobotState> state_;
+    std::atomic<std::shared_ptr<const StatusWindow>> status_;
+    StatusLog status_log_{64};
+    // Newest entry LabVIEW has acknowledged, and what status_ was built from.
+    std::uint64_t status_ack_ = 0;
+    std::uint64_t window_head_ = 0;
+    std::uint64_t window_ack_ = 0;
+    RobotState published_;
+    bool published_any_ = false;
+    std::atomic<std::int64_t> last_publish_ns_ = 0;
+    std::int64_t heartbeat_period_ns_ = 0;
+    rclcpp::CallbackGroup::SharedPtr heartbeat_group_;
+    rclcpp::TimerBase::SharedPtr heartbeat_timer_;
+
     // Service variables
     std::atomic<bool> cancel_action_ = false;
     std::atomic<bool> triggered_service_ = false;
 
     // Publisher fields
-    std::string msg_ = "idle";
     std::atomic<double> angle_ = 0.0;
     std::atomic<int> circle_state_ = 1;
     std::atomic<bool> scan_trigger_ = false;
@@ -378,6 +443,10 @@ class CoordinatorNode : public rclcpp::Node {
     std::atomic<bool> octa_mode_read_ = false;
     std::atomic<bool> oce_mode_read_ = false;
 
+    // Declared last so its thread is joined before anything it may format
+    // goes away.
+    BackgroundLogger diff_logger_{get_logger()};
+
     // template <class Flag>
     // void triggerFlag(Flag &flag, rclcpp::TimerBase::SharedPtr &timer_ptr,
     //                  std::weak_ptr<rclcpp::TimerBase> &weak_ptr,
@@ -417,6 +486,8 @@ class CoordinatorNode : public rclcpp::Node {
     //                 20ms, false);
     // }
 
+    // Raises apply_config for one period and holds it low for another before
+    // re-evaluating, so LabVIEW always sees a falling edge between pulses.
     void trigger_apply_config() {
         std::chrono::milliseconds duration = std::chrono::milliseconds(50);
         apply_config_ = true;
@@ -425,12 +496,16 @@ class CoordinatorNode : public rclcpp::Node {
             config_timer_.reset();
         }
         config_timer_ = create_wall_timer(duration, [this]() {
+            if (apply_config_) {
+                apply_config_ = false;
+                publishState();
+                return;
+            }
             if (auto t = config_timer_weak_.lock())
                 t->cancel();
-            apply_config_ = false;
+            dispatch(Event::ConfigPulse);
         });
         config_timer_weak_ = config_timer_;
-        // rclcpp::sleep_for(duration);
     }
 
     template <typename GH> bool goal_still_active(const GH &handle) {
@@ -443,13 +518,68 @@ class CoordinatorNode : public rclcpp::Node {
     }
 
     template <typename T>
-    void log_if_changed(const T &new_val, const T &old_val,
-                        const std::string &name, std::ostringstream &log) {
+    static void log_if_changed(const T &new_val, const T &old_val,
+                               const std::string &name,
+                               std::ostringstream &log) {
         if (new_val != old_val) {
             log << " " << name << ": " << new_val << "\n";
         }
     }
 
+    static std::string labview_diff(const octa_ros::msg::Labviewdata &old,
+                                    const octa_ros::msg::Labviewdata &now) {
+        std::ostringstream log;
+        log << "[SUBSCRIBING]: Changed fields \n";
+        const auto header = log.tellp();
+        log_if_changed(now.robot_vel, old.robot_vel, "robot_vel", log);
+        log_if_changed(now.robot_acc, old.robot_acc, "robot_acc", log);
+        log_if_changed(now.z_tolerance, old.z_tolerance, "z_tolerance", log);
+        log_if_changed(now.angle_tolerance, old.angle_tolerance,
+                       "angle_tolerance", log);
+        log_if_changed(now.radius, old.radius, "radius", log);
+        log_if_changed(now.angle_limit, old.angle_limit, "angle_limit", log);
+        log_if_changed(now.num_pt, old.num_pt, "num_pt", log);
+        log_if_changed(now.autofocus, old.autofocus, "autofocus", log);
+        log_if_changed(now.freedrive, old.freedrive, "freedrive", log);
+        log_if_changed(now.previous, old.previous, "previous", log);
+        log_if_changed(now.next, old.next, "next", log);
+        log_if_changed(now.home, old.home, "home", log);
+        log_if_changed(now.reset, old.reset, "reset", log);
+        log_if_changed(now.scan_trigger, old.scan_trigger, "scan_trigger",
+                       log);
+        log_if_changed(now.scan_3d, old.scan_3d, "scan_3d", log);
+        log_if_changed(now.z_height, old.z_height, "z_height", log);
+        log_if_changed(now.full_scan, old.full_scan, "full_scan", log);
+        log_if_changed(now.robot_mode, old.robot_mode, "robot_mode", log);
+        log_if_changed(now.oct_mode, old.oct_mode, "oct_mode", log);
+        log_if_changed(now.octa_mode, old.octa_mode, "octa_mode", log);
+        log_if_changed(now.oce_mode, old.oce_mode, "oce_mode", log);
+        // Nothing to say if only status_ack moved.
+        return log.tellp() == header ? std::string() : log.str();
+    }
+
+    // The status entries are not diffed.
+    static std::string robot_diff(const RobotState &old,
+                                  const RobotState &now) {
+        std::ostringstream log;
+        log << "[PUBLISHING]: Changed fields \n";
+        log_if_changed(now.angle, old.angle, "angle", log);
+        log_if_changed(now.circle_state, old.circle_state, "circle_state",
+                       log);
+        log_if_changed(now.scan_trigger, old.scan_trigger, "scan_trigger",
+                       log);
+        log_if_changed(now.apply_config, old.apply_config, "apply_config",
+                       log);
+        log_if_changed(now.end_state, old.end_state, "end_state", log);
+        log_if_changed(now.scan_3d, old.scan_3d, "scan_3d", log);
+        log_if_changed(now.full_scan, old.full_scan, "full_scan", log);
+        log_if_changed(now.robot_mode, old.robot_mode, "robot_mode", log);
+        log_if_changed(now.oct_mode, old.oct_mode, "oct_mode", log);
+        log_if_changed(now.octa_mode, old.octa_mode, "octa_mode", log);
+        log_if_changed(now.oce_mode, old.oce_mode, "oce_mode", log);
+        return log.str();
+    }
+
     void subscriberCallback(const octa_ros::msg::Labviewdata::SharedPtr msg) {
         robot_vel_ = msg->robot_vel;
         robot_acc_ = msg->robot_acc;
@@ -472,61 +602,19 @@ class CoordinatorNode : public rclcpp::Node {
         oct_mode_read_ = msg->oct_mode;
         octa_mode_read_ = msg->octa_mode;
         oce_mode_read_ = msg->oce_mode;
-        {
-            std::lock_guard<std::mutex> lock(data_mutex_);
-            if (*msg != old_sub_msg_) {
-                std::ostringstream sub_log;
-                sub_log << "[SUBSCRIBING]: Changed fields \n";
-
-                log_if_changed(msg->robot_vel, old_sub_msg_.robot_vel,
-                               "robot_vel", sub_log);
-                log_if_changed(msg->robot_acc, old_sub_msg_.robot_acc,
-                               "robot_acc", sub_log);
-                log_if_changed(msg->z_tolerance, old_sub_msg_.z_tolerance,
-                               "z_tolerance", sub_log);
-                log_if_changed(msg->angle_tolerance,
-                               old_sub_msg_.angle_tolerance, "angle_tolerance",
-                               sub_log);
-                log_if_changed(msg->radius, old_sub_msg_.radius, "radius",
-                               sub_log);
-                log_if_changed(msg->angle_limit, old_sub_msg_.angle_limit,
-                               "angle_limit", sub_log);
-                log_if_changed(msg->num_pt, old_sub_msg_.num_pt, "num_pt",
-                               sub_log);
-                log_if_changed(msg->autofocus, old_sub_msg_.autofocus,
-                               "autofocus", sub_log);
-                log_if_changed(msg->freedrive, old_sub_msg_.freedrive,
-                               "freedrive", sub_log);
-                log_if_changed(msg->previous, old_sub_msg_.previous, "previous",
-                               sub_log);
-                log_if_changed(msg->next, old_sub_msg_.next, "next", sub_log);
-                log_if_changed(msg->home, old_sub_msg_.home, "home", sub_log);
-                log_if_changed(msg->reset, old_sub_msg_.reset, "reset",
-                               sub_log);
-                log_if_changed(msg->scan_trigger, old_sub_msg_.scan_trigger,
-                               "scan_trigger", sub_log);
-                log_if_changed(msg->scan_3d, old_sub_msg_.scan_3d, "scan_3d",
-                               sub_log);
-                log_if_changed(msg->z_height, old_sub_msg_.z_height, "z_height",
-                               sub_log);
-                log_if_changed(msg->full_scan, old_sub_msg_.full_scan,
-                               "full_scan", sub_log);
-                log_if_changed(msg->robot_mode, old_sub_msg_.robot_mode,
-                               "robot_mode", sub_log);
-                log_if_changed(msg->oct_mode, old_sub_msg_.oct_mode, "oct_mode",
-                               sub_log);
-                log_if_changed(msg->octa_mode, old_sub_msg_.octa_mode,
-                               "octa_mode", sub_log);
-                log_if_changed(msg->oce_mode, old_sub_msg_.oce_mode, "oce_mode",
-                               sub_log);
-
-                RCLCPP_INFO(get_logger(), sub_log.str().c_str());
-            }
-	    if (!autofocus_.load()) {
-	        end_state_ = false;
-	    }
+        if (*msg != old_sub_msg_) {
+            diff_logger_.post([old = old_sub_msg_, now = *msg]() {
+                return labview_diff(old, now);
+            });
             old_sub_msg_ = *msg;
         }
+        if (!autofocus_.load()) {
+            end_state_ = false;
+        }
+        // An ack ahead of the log is left over from an earlier run.
+        status_ack_ =
+            msg->status_ack <= status_log_.head() ? msg->status_ack : 0;
+        dispatch(Event::Command);
     }
 
     void cancelCallback(const std_msgs::msg::Bool::SharedPtr msg) {
@@ -534,90 +622,199 @@ class CoordinatorNode : public rclcpp::Node {
         if (cancel_action_) {
             autofocus_ = false;
         }
+        dispatch(Event::Cancel);
     }
 
-    void publisherCallback() {
+    // Every input that can change a decision ends up here: the subscriptions,
+    // the action client callbacks, the scan_3d service and the apply_config
+    // timer. All of them run in the node's default mutually exclusive
+    // callback group, so the state machine is never advanced concurrently
+    // and reacts as soon as the message arrives.
+    void dispatch(Event event) {
+        const UserAction before = current_action_;
+        advance();
+        if (current_action_ != before) {
+            RCLCPP_DEBUG(get_logger(), "[%s] %s -> %s", to_string(event),
+                         to_string(before), to_string(current_action_));
+        }
+        publishState();
+    }
+
+    // Called after every change on the callback path. Publishes at once if
+    // anything in Robotdata changed and leaves the field diff to the
+    // background logger.
+    void publishState() {
+        if (status_log_.head() != window_head_ ||
+            status_ack_ != window_ack_) {
+            window_head_ = status_log_.head();
+            window_ack_ = status_ack_;
+            status_.store(make_status_window());
+        }
+
+        RobotState now;
+        now.angle = angle_.load();
+        now.circle_state = circle_state_.load();
+        now.status = status_log_.head();
+        now.scan_trigger = scan_trigger_.load();
+        now.apply_config = apply_config_.load();
+        now.end_state = end_state_.load();
+        now.scan_3d = scan_3d_.load();
+        now.full_scan = full_scan_.load();
+        now.robot_mode = robot_mode_.load();
+        now.oct_mode = oct_mode_.load();
+        now.octa_mode = octa_mode_.load();
+        now.oce_mode = oce_mode_.load();
+
+        if (published_any_ && now == published_) {
+            return;
+        }
+        RobotState old = published_;
+        published_ = now;
+        published_any_ = true;
+        state_.store(now);
+        publish(now, status_.load());
+        old.status = now.status;
+        if (old != now) {
+            diff_logger_.post([old, now]() { return robot_diff(old, now); });
+        }
+    }
+
+    // Republishes the last state if nothing was published for a heartbeat
+    // period, so LabVIEW can tell a quiet coordinator from a dead one. Runs
+    // in its own callback group and never waits on the callback path. The
+    // state and the status entries are read separately; a heartbeat racing a
+    // change may pair them wrongly, which the change's own publish fixes.
+    void heartbeat() {
+        const std::int64_t now = now_ns();
+        if (now - last_publish_ns_.load() < heartbeat_period_ns_) {
+            return;
+        }
+        publish(state_.load(), status_.load());
+    }
+
+    void publish(const RobotState &state,
+                 const std::shared_ptr<const StatusWindow> &status) {
         octa_ros::msg::Robotdata msg;
-        msg.msg = msg_;
-        msg.angle = angle_.load();
-        msg.circle_state = circle_state_.load();
-        msg.scan_trigger = scan_trigger_.load();
-        msg.apply_config = apply_config_.load();
-        msg.end_state = end_state_.load();
-        msg.scan_3d = scan_3d_.load();
-        msg.full_scan = full_scan_.load();
-        msg.robot_mode = robot_mode_.load();
-        msg.oct_mode = oct_mode_.load();
-        msg.octa_mode = octa_mode_.load();
-        msg.oce_mode = oce_mode_.load();
+        if (status) {
+            msg.msg = status->newest;
+            msg.status = status->entries;
+        }
+        msg.status_seq = state.status;
+        msg.angle = state.angle;
+        msg.circle_state = state.circle_state;
+        msg.scan_trigger = state.scan_trigger;
+        msg.apply_config = state.apply_config;
+        msg.end_state = state.end_state;
+        msg.scan_3d = state.scan_3d;
+        msg.full_scan = state.full_scan;
+        msg.robot_mode = state.robot_mode;
+        msg.oct_mode = state.oct_mode;
+        msg.octa_mode = state.octa_mode;
+        msg.oce_mode = state.oce_mode;
+        pub_handle_->publish(msg);
+        last_publish_ns_ = now_ns();
+    }
 
-        {
-            std::lock_guard<std::mutex> lock(data_mutex_);
-            if (msg != old_pub_msg_) {
-                std::ostringstream pub_log;
-                pub_log << "[PUBLISHING]: Changed fields \n";
-
-                log_if_changed(msg.angle, old_pub_msg_.angle, "angle", pub_log);
-                log_if_changed(msg.circle_state, old_pub_msg_.circle_state,
-                               "circle_state", pub_log);
-                log_if_changed(msg.scan_trigger, old_pub_msg_.scan_trigger,
-                               "scan_trigger", pub_log);
-                log_if_changed(msg.apply_config, old_pub_msg_.apply_config,
-                               "apply_config", pub_log);
-                log_if_changed(msg.end_state, old_pub_msg_.end_state,
-                               "end_state", pub_log);
-                log_if_changed(msg.scan_3d, old_pub_msg_.scan_3d, "scan_3d",
-                               pub_log);
-                log_if_changed(msg.full_scan, old_pub_msg_.full_scan,
-                               "full_scan", pub_log);
-                log_if_changed(msg.robot_mode, old_pub_msg_.robot_mode,
-                               "robot_mode", pub_log);
-                log_if_changed(msg.oct_mode, old_pub_msg_.oct_mode, "oct_mode",
-                               pub_log);
-                log_if_changed(msg.octa_mode, old_pub_msg_.octa_mode,
-                               "octa_mode", pub_log);
-                log_if_changed(msg.oce_mode, old_pub_msg_.oce_mode, "oce_mode",
-                               pub_log);
-
-                RCLCPP_INFO(get_logger(), pub_log.str().c_str());
-            }
-            pub_handle_->publish(msg);
-            old_pub_msg_ = msg;
+    // Only the entries LabVIEW has not acknowledged, so the message stays the
+    // same size however long the coordinator runs.
+    std::shared_ptr<const StatusWindow> make_status_window() const {
+        auto window = std::make_shared<StatusWindow>();
+        if (const StatusLog::Entry *newest = status_log_.newest()) {
+            window->newest = newest->text;
+        }
+        for (const StatusLog::Entry *entry : status_log_.since(
+                 status_ack_, octa_ros::msg::Robotdata::STATUS_WINDOW)) {
+            octa_ros::msg::StatusEntry out;
+            out.seq = entry->seq;
+            out.stamp = rclcpp::Time(entry->stamp_ns);
+            out.source = entry->source;
+            out.level = static_cast<std::uint8_t>(entry->level);
+            out.code = entry->code;
+            out.text = entry->text;
+            window->entries.push_back(std::move(out));
         }
+        return window;
     }
 
-    void mainLoop() {
+    // Adds a line to the status log sent to LabVIEW and to the node's own
+    // log. Empty lines and repeats of the newest line are dropped.
+    void status(const char *source, StatusLog::Level level,
+                std::string_view text, std::int32_t code = 0) {
+        if (text.find_first_not_of("\r\n") == std::string_view::npos) {
+            return;
+        }
+        const std::uint64_t head = status_log_.head();
+        if (status_log_.push(source, level, code, text,
+                             now().nanoseconds()) == head) {
+            return;
+        }
+        const char *line = status_log_.newest()->text.c_str();
+        switch (level) {
+        case StatusLog::Level::Info:
+            RCLCPP_INFO(get_logger(), "[%s] %s", source, line);
+            break;
+        case StatusLog::Level::Warn:
+            RCLCPP_WARN(get_logger(), "[%s] %s", source, line);
+            break;
+        case StatusLog::Level::Error:
+            RCLCPP_ERROR(get_logger(), "[%s] %s", source, line);
+            break;
+        }
+    }
+
+    void info(std::string_view text) {
+        status("coordinator", StatusLog::Level::Info, text);
+    }
+
+    void status_result(const char *source, rclcpp_action::ResultCode code,
+                       std::string_view text) {
+        StatusLog::Level level = StatusLog::Level::Warn;
+        if (code == rclcpp_action::ResultCode::SUCCEEDED) {
+            level = StatusLog::Level::Info;
+        } else if (code == rclcpp_action::ResultCode::ABORTED) {
+            level = StatusLog::Level::Error;
+        }
+        status(source, level, text, static_cast<std::int32_t>(code));
+    }
+
+    static std::int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // One step of the state machine, level-triggered on the latest LabVIEW
+    // command. Goals are only sent when the action changes, so running it on
+    // an event that changed nothing is harmless.
+    void advance() {
         if (cancel_action_) {
             if (goal_still_active(active_focus_goal_handle_)) {
-                msg_ = "Canceling Focus action\n";
-                RCLCPP_INFO(this->get_logger(), msg_.c_str());
+                info("Canceling Focus action");
                 focus_action_client_->async_cancel_goal(
                     active_focus_goal_handle_);
             }
             if (goal_still_active(active_move_z_goal_handle_)) {
-                msg_ = "Canceling Move Z-angle action\n";
-                RCLCPP_INFO(this->get_logger(), msg_.c_str());
+                info("Canceling Move Z-angle action");
                 move_z_angle_action_client_->async_cancel_goal(
                     active_move_z_goal_handle_);
             }
             if (goal_still_active(active_freedrive_goal_handle_)) {
-                msg_ = "Canceling Free-drive\n";
-                RCLCPP_INFO(this->get_logger(), msg_.c_str());
+                info("Canceling Free-drive");
                 freedrive_action_client_->async_cancel_goal(
                     active_freedrive_goal_handle_);
             }
             if (goal_still_active(active_reset_goal_handle_)) {
-                msg_ = "Canceling Reset action\n";
-                RCLCPP_INFO(this->get_logger(), msg_.c_str());
+                info("Canceling Reset action");
                 reset_action_client_->async_cancel_goal(
                     active_reset_goal_handle_);
             }
             if (full_scan_read_) {
                 full_scan_ = false;
-                msg_ = "Canceling Full Scan action\n";
-                RCLCPP_INFO(this->get_logger(), msg_.c_str());
+                info("Canceling Full Scan action");
+            }
+            if (pipeline_) {
+                pipeline_->abort();
             }
-            pc_ = 0;
             scan_state_ = ScanState::IDLE;
             current_action_ = UserAction::None;
             previous_action_ = UserAction::None;
@@ -627,61 +824,19 @@ class CoordinatorNode : public rclcpp::Node {
         }
 
         if (full_scan_read_) {
-            full_scan_ = true;
-            if ((pc_.load() + 1) > full_scan_recipe.size()) {
-                full_scan_ = false;
-                msg_ = "Full Scan complete!\n";
-                return;
-            }
-            const Step &step = full_scan_recipe[pc_.load()];
-            robot_mode_ = (step.mode == Mode::ROBOT);
-            oct_mode_ = (step.mode == Mode::OCT);
-            octa_mode_ = (step.mode == Mode::OCTA);
-            oce_mode_ = (step.mode == Mode::OCE);
-            std::string action_mode;
-            std::string scan_mode;
-            if (robot_mode_) {
-                scan_mode = "ROBOT Mode";
-            } else if (oct_mode_) {
-                scan_mode = "OCT Mode";
-            } else if (octa_mode_) {
-                scan_mode = "OCTA Mode";
-            } else if (oce_mode_) {
-                scan_mode = "OCE Mode";
-            }
-            if (step.action == UserAction::Focus) {
-                action_mode = "Focus Action";
-            } else if (step.action == UserAction::MoveZangle) {
-                action_mode = "MoveZangle Action";
-            } else if (step.action == UserAction::Scan) {
-                action_mode = "Scanning Action";
-            }
-            msg_ = std::format("Step [{}/{}]: {}, {}\n", pc_.load() + 1,
-                               full_scan_recipe.size(), action_mode, scan_mode);
-
-            if (robot_mode_read_.load() != robot_mode_.load() ||
-                oct_mode_read_.load() != oct_mode_.load() ||
-                octa_mode_read_.load() != octa_mode_.load() ||
-                oce_mode_read_.load() != oce_mode_.load()) {
-                if (!apply_config_) {
-                    trigger_apply_config();
-                }
-                return;
-            }
-
-            yaw_ = step.arg;
-            current_action_ = step.action;
-            autofocus_ = (current_action_ == UserAction::Focus);
-        } else {
-            if (freedrive_) {
-                current_action_ = UserAction::Freedrive;
-            } else if (reset_) {
-                current_action_ = UserAction::Reset;
-            } else if (autofocus_) {
-                current_action_ = UserAction::Focus;
-            } else if (next_ || previous_ || home_) {
-                current_action_ = UserAction::MoveZangle;
-            }
+            advanceFullScan();
+            return;
+        }
+        pipeline_.reset();
+
+        if (freedrive_) {
+            current_action_ = UserAction::Freedrive;
+        } else if (reset_) {
+            current_action_ = UserAction::Reset;
+        } else if (autofocus_) {
+            current_action_ = UserAction::Focus;
+        } else if (next_ || previous_ || home_) {
+            current_action_ = UserAction::MoveZangle;
         }
 
         switch (current_action_) {
@@ -691,14 +846,12 @@ class CoordinatorNode : public rclcpp::Node {
                     sendFreedriveGoal(true);
                     circle_state_ = 1;
                     angle_ = 0.0;
-                    msg_ = "[Action] Freedrive Mode ON\n";
-                    RCLCPP_INFO(get_logger(), msg_.c_str());
+                    info("[Action] Freedrive Mode ON");
                     previous_action_ = UserAction::Freedrive;
                 }
             } else {
                 sendFreedriveGoal(false);
-                msg_ = "[Action] Freedrive Mode OFF\n";
-                RCLCPP_INFO(get_logger(), msg_.c_str());
+                info("[Action] Freedrive Mode OFF");
                 current_action_ = UserAction::None;
                 previous_action_ = UserAction::None;
             }
@@ -707,10 +860,8 @@ class CoordinatorNode : public rclcpp::Node {
             if (previous_action_ != current_action_) {
                 angle_ = 0.0;
                 circle_state_ = 1;
-                msg_ = "[Action] Reset to default position. It may take "
-                       "some time "
-                       "please wait.\n";
-                RCLCPP_INFO(get_logger(), msg_.c_str());
+                info("[Action] Reset to default position. It may take some "
+                     "time please wait.");
                 sendResetGoal();
                 previous_action_ = UserAction::Reset;
             }
@@ -720,14 +871,12 @@ class CoordinatorNode : public rclcpp::Node {
                 if (previous_action_ != current_action_) {
 		    success_ = false;
                     sendFocusGoal();
-                    msg_ = "[Action] Focusing\n";
-                    RCLCPP_INFO(get_logger(), msg_.c_str());
+                    info("[Action] Focusing");
                     previous_action_ = UserAction::Focus;
                 }
             } else {
                 if (!success_) {
-                    msg_ = "Canceling Focus action\n";
-                    RCLCPP_INFO(this->get_logger(), msg_.c_str());
+                    info("Canceling Focus action");
                     if (goal_still_active(active_focus_goal_handle_)) {
                         focus_action_client_->async_cancel_goal(
                             active_focus_goal_handle_);
@@ -743,15 +892,14 @@ class CoordinatorNode : public rclcpp::Node {
                         : (angle_limit_ / static_cast<double>(num_pt_));
                 if (next_) {
                     yaw_ = angle_increment_;
-                    msg_ = std::format("[Action] Next: {}\n", yaw_);
+                    info(std::format("[Action] Next: {}", yaw_));
                 } else if (previous_) {
                     yaw_ = -angle_increment_;
-                    msg_ = std::format("[Action] Previous: {}\n", yaw_);
+                    info(std::format("[Action] Previous: {}", yaw_));
                 } else if (home_) {
                     yaw_ = -angle_;
-                    msg_ = std::format("[Action] Home: {}\n", yaw_);
+                    info(std::format("[Action] Home: {}", yaw_));
                 }
-                RCLCPP_INFO(get_logger(), msg_.c_str());
                 sendMoveZAngleGoal(yaw_);
                 if (std::abs(angle_.load()) < 1e-6) {
                     circle_state_ = 1;
@@ -760,29 +908,6 @@ class CoordinatorNode : public rclcpp::Node {
                 previous_action_ = UserAction::MoveZangle;
             }
             break;
-        case UserAction::Scan:
-            if (previous_action_ != current_action_) {
-                if (scan_state_ == ScanState::IDLE) {
-                    msg_ += std::format("  [Action] Scanning\n");
-                    RCLCPP_INFO(get_logger(), msg_.c_str());
-                    scan_trigger_ = true;
-                    scan_state_ = ScanState::BUSY;
-                    scan_trigger_store_ = scan_trigger_read_.load();
-                    current_action_ = UserAction::None;
-                    previous_action_ = UserAction::Scan;
-                }
-            } else {
-                if (scan_trigger_read_.load() != scan_trigger_store_) {
-                    scan_trigger_ = false;
-                    msg_ += "Scan Complete\n";
-                    RCLCPP_INFO(this->get_logger(), msg_.c_str());
-                    scan_state_ = ScanState::IDLE;
-                    previous_action_ = UserAction::None;
-                    pc_.fetch_add(1);
-                    scan_trigger_store_ = scan_trigger_read_.load();
-                }
-            }
-            break;
         default:
             robot_mode_ = robot_mode_read_.load();
             oct_mode_ = oct_mode_read_.load();
@@ -791,11 +916,153 @@ class CoordinatorNode : public rclcpp::Node {
             scan_3d_ = false;
             triggered_service_ = false;
             scan_trigger_ = false;
-	    pc_ = 0;
             break;
         }
     }
 
+    // Full-scan mode: finish the tasks that complete on LabVIEW's echo and
+    // start every task whose dependencies are done, until nothing changes.
+    // Action tasks finish in their result callbacks, which dispatch again.
+    void advanceFullScan() {
+        if (!pipeline_) {
+            if (!plan_) {
+                status("recipe", StatusLog::Level::Error,
+                       "Full Scan needs a recipe; see load_recipe");
+                full_scan_ = false;
+                return;
+            }
+            pipeline_ = std::make_unique<ScanPipeline>(plan_->steps,
+                                                       pipelined_);
+            RCLCPP_INFO(get_logger(),
+                        "Full scan '%s': %zu steps as %zu tasks%s, about "
+                        "%.0f s in order",
+                        plan_->name.c_str(), pipeline_->steps(),
+                        pipeline_->size(), pipelined_ ? ", pipelined" : "",
+                        plan_->expected_total_s);
+        }
+        if (pipeline_->failed() || pipeline_->done()) {
+            full_scan_ = false;
+            return;
+        }
+        full_scan_ = true;
+
+        bool progressed = true;
+        while (progressed) {
+            progressed = pollFullScan();
+            for (std::size_t id : pipeline_->ready()) {
+                startFullScanTask(id);
+                progressed = true;
+            }
+        }
+
+        if (pipeline_->done()) {
+            full_scan_ = false;
+            const ScanPipeline::Report report = pipeline_->report();
+            const double wall = static_cast<double>(report.wall_ns) * 1e-9;
+            const double serial =
+                static_cast<double>(report.serial_ns) * 1e-9;
+            info(std::format("Full Scan complete! {:.1f} s; its steps took "
+                             "{:.1f} s, {:.1f} s saved by overlapping them",
+                             wall, serial, serial - wall));
+        }
+    }
+
+    // Finishes the running Configure and Scan tasks once LabVIEW reports
+    // them done. Returns true if any finished.
+    bool pollFullScan() {
+        bool finished = false;
+        if (auto id = pipeline_->running(ScanPipeline::Kind::Configure)) {
+            if (mode_applied(pipeline_->task(*id).mode)) {
+                pipeline_->finish(*id, now_ns());
+                finished = true;
+            } else if (!apply_config_) {
+                trigger_apply_config();
+            }
+        }
+        if (auto id = pipeline_->running(ScanPipeline::Kind::Scan)) {
+            if (scan_trigger_read_.load() != scan_trigger_store_) {
+                scan_trigger_ = false;
+                info("Scan Complete");
+                scan_state_ = ScanState::IDLE;
+                scan_trigger_store_ = scan_trigger_read_.load();
+                pipeline_->finish(*id, now_ns());
+                finished = true;
+            }
+        }
+        return finished;
+    }
+
+    void startFullScanTask(std::size_t id) {
+        const ScanPipeline::Task &task = pipeline_->task(id);
+        pipeline_->start(id, now_ns());
+        const std::string step =
+            std::format("Step [{}/{}]:", task.step + 1, pipeline_->steps());
+        switch (task.kind) {
+        case ScanPipeline::Kind::Configure:
+            info(std::format("{} Configuring {} Mode", step,
+                             to_string(task.mode)));
+            set_mode(task.mode);
+            break;
+        case ScanPipeline::Kind::Focus:
+            info(std::format("{} Focus Action, {} Mode", step,
+                             to_string(task.mode)));
+            success_ = false;
+            sendFocusGoal();
+            break;
+        case ScanPipeline::Kind::PlanMove:
+            RCLCPP_DEBUG(get_logger(), "%s planning a %+.1f deg move",
+                         step.c_str(), task.arg);
+            sendMoveZAngleGoal(task.arg, true);
+            break;
+        case ScanPipeline::Kind::Move:
+            info(std::format("{} MoveZangle Action, {:+} deg to {:+} deg",
+                             step, task.arg, plan_->yaw_deg[task.step]));
+            yaw_ = task.arg;
+            sendMoveZAngleGoal(task.arg);
+            break;
+        case ScanPipeline::Kind::Scan:
+            info(std::format("{} Scanning Action, {} Mode", step,
+                             to_string(task.mode)));
+            scan_trigger_ = true;
+            scan_state_ = ScanState::BUSY;
+            scan_trigger_store_ = scan_trigger_read_.load();
+            break;
+        }
+    }
+
+    // An action started by the full scan has finished. A failed plan is not
+    // fatal: the move then plans for itself.
+    void finishFullScanTask(ScanPipeline::Kind kind, bool ok) {
+        if (!pipeline_) {
+            return;
+        }
+        const auto id = pipeline_->running(kind);
+        if (!id) {
+            return;
+        }
+        if (ok || kind == ScanPipeline::Kind::PlanMove) {
+            pipeline_->finish(*id, now_ns());
+        } else {
+            pipeline_->fail(*id, now_ns());
+            full_scan_ = false;
+        }
+    }
+
+    void set_mode(Mode mode) {
+        robot_mode_ = (mode == Mode::ROBOT);
+        oct_mode_ = (mode == Mode::OCT);
+        octa_mode_ = (mode == Mode::OCTA);
+        oce_mode_ = (mode == Mode::OCE);
+    }
+
+    // LabVIEW echoes the mode once it has switched to it.
+    bool mode_applied(Mode mode) const {
+        return robot_mode_read_.load() == (mode == Mode::ROBOT) &&
+               oct_mode_read_.load() == (mode == Mode::OCT) &&
+               octa_mode_read_.load() == (mode == Mode::OCTA) &&
+               oce_mode_read_.load() == (mode == Mode::OCE);
+    }
+
     void sendFocusGoal() {
         FocusAction::Goal goal_msg;
         goal_msg.angle_tolerance = angle_tolerance_;
@@ -807,45 +1074,46 @@ class CoordinatorNode : public rclcpp::Node {
         options.feedback_callback =
             [this](FocusGoalHandle::SharedPtr,
                    const std::shared_ptr<const FocusAction::Feedback> fb) {
-                msg_ += fb->debug_msgs;
-                RCLCPP_INFO(this->get_logger(), "Focus feedback => %s",
-                            msg_.c_str());
+                status("focus", StatusLog::Level::Info, fb->debug_msgs);
+                publishState();
             };
 
         options.result_callback =
             [this](const FocusGoalHandle::WrappedResult &result) {
                 current_action_ = UserAction::None;
                 previous_action_ = UserAction::None;
-                msg_ += result.result->status;
+                status_result("focus", result.code, result.result->status);
                 end_state_ = true;
 		success_ = true;
                 switch (result.code) {
                 case rclcpp_action::ResultCode::SUCCEEDED:
                     RCLCPP_INFO(this->get_logger(), "Focus action SUCCEEDED");
-                    if (full_scan_read_) {
-                        pc_.fetch_add(1);
-                    }
+                    finishFullScanTask(ScanPipeline::Kind::Focus, true);
                     break;
                 case rclcpp_action::ResultCode::ABORTED:
                     RCLCPP_WARN(this->get_logger(), "Focus action ABORTED");
                     if (full_scan_read_) {
-                        full_scan_ = false;
-                        msg_ = "Focus action aborted, aborting full scan\n";
+                        finishFullScanTask(ScanPipeline::Kind::Focus, false);
+                        status("focus", StatusLog::Level::Error,
+                               "Focus action aborted, aborting full scan");
                     }
                     break;
                 case rclcpp_action::ResultCode::CANCELED:
                     RCLCPP_WARN(this->get_logger(), "Focus action CANCELED");
                     if (full_scan_read_) {
-                        full_scan_ = false;
-                        msg_ = "Focus action canceled, aborting full scan\n";
+                        finishFullScanTask(ScanPipeline::Kind::Focus, false);
+                        status("focus", StatusLog::Level::Warn,
+                               "Focus action canceled, aborting full scan");
                     }
                     break;
                 default:
                     RCLCPP_WARN(this->get_logger(),
                                 "Focus action UNKNOWN result code");
+                    finishFullScanTask(ScanPipeline::Kind::Focus, false);
                     break;
                 }
                 active_focus_goal_handle_.reset();
+                dispatch(Event::GoalResult);
             };
 
         options.goal_response_callback =
@@ -854,37 +1122,54 @@ class CoordinatorNode : public rclcpp::Node {
                 if (!active_focus_goal_handle_) {
                     RCLCPP_ERROR(this->get_logger(),
                                  "Focus goal was rejected by server");
+                    finishFullScanTask(ScanPipeline::Kind::Focus, false);
                 } else {
                     RCLCPP_INFO(this->get_logger(),
                                 "Focus goal accepted; waiting for result");
                 }
+                dispatch(Event::GoalResponse);
             };
 
         focus_action_client_->async_send_goal(goal_msg, options);
     }
 
-    void sendMoveZAngleGoal(double yaw) {
+    // With `plan_only` the server only plans the move and keeps the plan for
+    // an identical goal sent while the arm has not moved.
+    void sendMoveZAngleGoal(double yaw, bool plan_only = false) {
         MoveZAngle::Goal goal_msg;
         goal_msg.target_angle = yaw;
         goal_msg.radius = radius_.load();
         goal_msg.angle = angle_.load();
+        goal_msg.plan_only = plan_only;
 
         auto options = rclcpp_action::Client<MoveZAngle>::SendGoalOptions();
 
         options.feedback_callback =
             [this](MoveZGoalHandle::SharedPtr,
                    const std::shared_ptr<const MoveZAngle::Feedback> fb) {
-                msg_ += fb->debug_msgs;
-                RCLCPP_INFO(this->get_logger(),
-                            "MoveZAngle feedback => target_angle_z=%.2f",
-                            fb->current_z_angle);
+                status("move_z_angle", StatusLog::Level::Info,
+                       fb->debug_msgs);
+                RCLCPP_DEBUG(this->get_logger(),
+                             "MoveZAngle feedback => target_angle_z=%.2f",
+                             fb->current_z_angle);
+                publishState();
             };
 
         options.result_callback =
-            [this, yaw](const MoveZGoalHandle::WrappedResult &result) {
+            [this, goal_msg](const MoveZGoalHandle::WrappedResult &result) {
+                if (goal_msg.plan_only) {
+                    RCLCPP_DEBUG(get_logger(), "MoveZAngle plan: %s",
+                                 result.result->status.c_str());
+                    finishFullScanTask(ScanPipeline::Kind::PlanMove, true);
+                    active_move_z_goal_handle_.reset();
+                    dispatch(Event::GoalResult);
+                    return;
+                }
+                const double yaw = goal_msg.target_angle;
                 current_action_ = UserAction::None;
                 previous_action_ = UserAction::None;
-                msg_ += result.result->status;
+                status_result("move_z_angle", result.code,
+                              result.result->status);
                 switch (result.code) {
                 case rclcpp_action::ResultCode::SUCCEEDED:
                     if (yaw > 0.0) {
@@ -894,42 +1179,51 @@ class CoordinatorNode : public rclcpp::Node {
                     }
                     angle_.fetch_add(yaw);
                     RCLCPP_INFO(this->get_logger(), "MoveZAngle SUCCEEDED");
-                    if (full_scan_read_) {
-                        pc_.fetch_add(1);
-                    }
+                    finishFullScanTask(ScanPipeline::Kind::Move, true);
                     break;
                 case rclcpp_action::ResultCode::ABORTED:
                     RCLCPP_WARN(this->get_logger(), "MoveZAngle ABORTED");
                     if (full_scan_read_) {
-                        full_scan_ = false;
-                        msg_ = "Move Z angle action aborted, aborting full scan\n";
+                        finishFullScanTask(ScanPipeline::Kind::Move, false);
+                        status("move_z_angle", StatusLog::Level::Error,
+                               "Move Z angle action aborted, aborting full "
+                               "scan");
                     }
                     break;
                 case rclcpp_action::ResultCode::CANCELED:
                     RCLCPP_WARN(this->get_logger(), "MoveZAngle CANCELED");
                     if (full_scan_read_) {
-                        full_scan_ = false;
-                        msg_ = "Move Z angle action canceled, aborting full scan\n";
+                        finishFullScanTask(ScanPipeline::Kind::Move, false);
+                        status("move_z_angle", StatusLog::Level::Warn,
+                               "Move Z angle action canceled, aborting full "
+                               "scan");
                     }
                     break;
                 default:
                     RCLCPP_WARN(this->get_logger(), "MoveZAngle UNKNOWN code");
+                    finishFullScanTask(ScanPipeline::Kind::Move, false);
                     break;
                 }
                 active_move_z_goal_handle_.reset();
+                dispatch(Event::GoalResult);
             };
 
         options.goal_response_callback =
-            [this](MoveZGoalHandle::SharedPtr goal_handle) {
+            [this, plan_only](MoveZGoalHandle::SharedPtr goal_handle) {
                 active_move_z_goal_handle_ = goal_handle;
                 if (!active_move_z_goal_handle_) {
                     RCLCPP_ERROR(this->get_logger(),
                                  "Move Z Angle goal was rejected by server");
+                    finishFullScanTask(plan_only
+                                           ? ScanPipeline::Kind::PlanMove
+                                           : ScanPipeline::Kind::Move,
+                                       false);
                 } else {
                     RCLCPP_INFO(
                         this->get_logger(),
                         "Move Z Angle goal accepted; waiting for result");
                 }
+                dispatch(Event::GoalResponse);
             };
 
         move_z_angle_action_client_->async_send_goal(goal_msg, options);
@@ -944,14 +1238,13 @@ class CoordinatorNode : public rclcpp::Node {
         options.feedback_callback =
             [this](FreedriveGoalHandle::SharedPtr,
                    const std::shared_ptr<const Freedrive::Feedback> fb) {
-                msg_ += fb->debug_msgs;
-                RCLCPP_INFO(this->get_logger(), "Freedrive feedback => %s",
-                            fb->debug_msgs.c_str());
+                status("freedrive", StatusLog::Level::Info, fb->debug_msgs);
+                publishState();
             };
 
         options.result_callback =
             [this](const FreedriveGoalHandle::WrappedResult &result) {
-                msg_ += result.result->status;
+                status_result("freedrive", result.code, result.result->status);
                 switch (result.code) {
                 case rclcpp_action::ResultCode::SUCCEEDED:
                     RCLCPP_INFO(this->get_logger(), "Freedrive SUCCESS");
@@ -967,6 +1260,7 @@ class CoordinatorNode : public rclcpp::Node {
                     break;
                 }
                 active_freedrive_goal_handle_.reset();
+                dispatch(Event::GoalResult);
             };
 
         options.goal_response_callback =
@@ -979,6 +1273,7 @@ class CoordinatorNode : public rclcpp::Node {
                     RCLCPP_INFO(this->get_logger(),
                                 " Freedrive goal accepted; waiting for result");
                 }
+                dispatch(Event::GoalResponse);
             };
 
         freedrive_action_client_->async_send_goal(goal_msg, options);
@@ -993,37 +1288,38 @@ class CoordinatorNode : public rclcpp::Node {
         options.feedback_callback =
             [this](ResetGoalHandle::SharedPtr,
                    const std::shared_ptr<const Reset::Feedback> fb) {
-                msg_ += fb->debug_msgs;
-                RCLCPP_INFO(this->get_logger(), "Reset feedback => %s",
-                            fb->debug_msgs.c_str());
+                status("reset", StatusLog::Level::Info, fb->debug_msgs);
+                publishState();
             };
 
         options.result_callback =
             [this](const ResetGoalHandle::WrappedResult &result) {
                 current_action_ = UserAction::None;
                 previous_action_ = UserAction::None;
-                msg_ += result.result->status;
+                status_result("reset", result.code, result.result->status);
                 switch (result.code) {
                 case rclcpp_action::ResultCode::SUCCEEDED:
-                    if (call_capture_background()) {
-                        msg_ += "\nBackground Captured\n";
-                    }
+                    request_capture_background();
                     RCLCPP_INFO(this->get_logger(), "Reset SUCCESS");
                     break;
                 case rclcpp_action::ResultCode::ABORTED:
-                    msg_ += "\nReset position abort\n";
+                    status("reset", StatusLog::Level::Error,
+                           "Reset position abort");
                     RCLCPP_WARN(this->get_logger(), "Reset ABORTED");
                     break;
                 case rclcpp_action::ResultCode::CANCELED:
-                    msg_ += "\nReset position canceled\n";
+                    status("reset", StatusLog::Level::Warn,
+                           "Reset position canceled");
                     RCLCPP_WARN(this->get_logger(), "Reset CANCELED");
                     break;
                 default:
-                    msg_ += "\nReset position unknown code\n";
+                    status("reset", StatusLog::Level::Warn,
+                           "Reset position unknown code");
                     RCLCPP_WARN(this->get_logger(), "Reset UNKNOWN code");
                     break;
                 }
                 active_reset_goal_handle_.reset();
+                dispatch(Event::GoalResult);
             };
 
         options.goal_response_callback =
@@ -1036,6 +1332,7 @@ class CoordinatorNode : public rclcpp::Node {
                     RCLCPP_INFO(this->get_logger(),
                                 " Reset goal accepted; waiting for result");
                 }
+                dispatch(Event::GoalResponse);
             };
 
         reset_action_client_->async_send_goal(goal_msg, options);
@@ -1064,29 +1361,64 @@ class CoordinatorNode : public rclcpp::Node {
                 response->success = false;
             }
         }
+        dispatch(Event::Scan3d);
     }
 
-    bool call_capture_background() {
-        if (!service_capture_background_->wait_for_service(
-                std::chrono::milliseconds(200)))
-            return false;
+    void loadRecipeCallback(const std::shared_ptr<LoadRecipe::Request> request,
+                            std::shared_ptr<LoadRecipe::Response> response) {
+        if (pipeline_) {
+            response->success = false;
+            response->message =
+                "A full scan holds the current recipe until full_scan clears";
+            return;
+        }
+        try {
+            response->message = load_recipe(request->recipe);
+            response->success = true;
+            response->steps = static_cast<std::uint32_t>(plan_->steps.size());
+            response->expected_duration = plan_->expected_total_s;
+        } catch (const std::exception &e) {
+            response->success = false;
+            response->message = e.what();
+            status("recipe", StatusLog::Level::Error,
+                   std::format("Recipe '{}' rejected: {}", request->recipe,
+                               e.what()));
+        }
+        publishState();
+    }
+
+    // Compiles the recipe and makes it the full-scan plan, returning a
+    // summary. Throws, keeping the current plan, if the recipe cannot be
+    // read or fails validation.
+    std::string load_recipe(const std::string &recipe) {
+        const std::string share =
+            ament_index_cpp::get_package_share_directory("octa_ros");
+        plan_ = load_scan_plan(recipe_path(recipe, share));
+        std::string summary =
+            std::format("Recipe '{}': {} steps, about {:.0f} s", plan_->name,
+                        plan_->steps.size(), plan_->expected_total_s);
+        status("recipe", StatusLog::Level::Info, summary);
+        return summary;
+    }
 
+    // Asynchronous: the response is handled by this node's executor, which
+    // cannot run while the reset result callback is still blocked on it.
+    void request_capture_background() {
+        if (!service_capture_background_->service_is_ready()) {
+            RCLCPP_WARN(get_logger(), "capture_background is not available");
+            return;
+        }
         auto req = std::make_shared<std_srvs::srv::Trigger::Request>();
-        auto fut = service_capture_background_->async_send_request(req);
-        return fut.wait_for(std::chrono::milliseconds(1000)) ==
-                   std::future_status::ready &&
-               fut.get()->success;
+        service_capture_background_->async_send_request(
+            req,
+            [this](rclcpp::Client<std_srvs::srv::Trigger>::SharedFuture fut) {
+                if (fut.get()->success) {
+                    status("reset", StatusLog::Level::Info,
+                           "Background Captured");
+                    publishState();
+                }
+            });
     }
 };
 
-int main(int argc, char *argv[]) {
-    rclcpp::init(argc, argv);
-    auto node = std::make_shared<CoordinatorNode>();
-    node->init();
-    // rclcpp::executors::MultiThreadedExecutor exec;
-    // exec.add_node(node);
-    // exec.spin();
-    rclcpp::spin(node);
-    rclcpp::shutdown();
-    return 0;
-}
+RCLCPP_COMPONENTS_REGISTER_NODE(CoordinatorNode)
@@ -0,0 +1,103 @@
+#include "debug_writer.hpp"
+
+#include <algorithm>
+#include <format>
+
+DebugWriter::DebugWriter(Options options) : options_(std::move(options)) {
+    if (options_.mode != Mode::Off) {
+        thread_ = std::thread([this]() { run(); });
+    }
+}
+
+DebugWriter::~DebugWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+std::optional<DebugWriter::Mode>
+DebugWriter::parse_mode(std::string_view name) {
+    if (name == "off") {
+        return Mode::Off;
+    }
+    if (name == "every_nth") {
+        return Mode::EveryNth;
+    }
+    if (name == "on_failure") {
+        return Mode::OnFailure;
+    }
+    return std::nullopt;
+}
+
+bool DebugWriter::submit(const FrameHandle &raw, const cv::Mat &detected,
+                         bool failed) {
+    if (options_.mode == Mode::Off) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::uint64_t index = offered_++;
+    bool wanted = options_.mode == Mode::OnFailure
+                      ? failed
+                      : index % std::max(1, options_.every_n) == 0;
+    if (!wanted) {
+        return false;
+    }
+    if (queue_.size() >= options_.queue_depth) {
+        dropped_.fetch_add(1);
+        return false;
+    }
+    queue_.push_back(Job{index, failed, raw, detected});
+    cv_.notify_one();
+    return true;
+}
+
+void DebugWriter::run() {
+    std::error_code ec;
+    std::filesystem::create_directories(options_.directory, ec);
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            job = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        write(job);
+    }
+}
+
+void DebugWriter::write(const Job &job) {
+    const std::string suffix = job.failed ? "_failed" : "";
+    bool ok = true;
+    try {
+        if (!job.raw.empty()) {
+            ok &= cv::imwrite(
+                (options_.directory /
+                 std::format("raw_image{:06}{}.png", job.index, suffix))
+                    .string(),
+                job.raw.mat());
+        }
+        if (!job.detected.empty()) {
+            ok &= cv::imwrite(
+                (options_.directory /
+                 std::format("detected_image{:06}{}.jpg", job.index, suffix))
+                    .string(),
+                job.detected);
+        }
+    } catch (const cv::Exception &) {
+        ok = false;
+    }
+    if (ok) {
+        written_.fetch_add(1);
+    } else {
+        errors_.fetch_add(1);
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef DEBUG_WRITER_HPP
+#define DEBUG_WRITER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+
+#include <opencv2/opencv.hpp>
+
+#include "frame_handle.hpp"
+
+// Writes raw and detected frames from the focus loop to disk on a background
+// thread. submit() only pushes onto a bounded queue and drops the frame when
+// the queue is full, so the caller never waits on encoding or disk I/O.
+//
+// Frames are queued by reference (cv::Mat or FrameHandle sharing), not
+// copied; callers must not write into a submitted frame afterwards.
+class DebugWriter {
+  public:
+    enum class Mode { Off, EveryNth, OnFailure };
+
+    struct Options {
+        Mode mode = Mode::Off;
+        int every_n = 1;
+        std::filesystem::path directory = ".";
+        std::size_t queue_depth = 16;
+    };
+
+    explicit DebugWriter(Options options);
+    ~DebugWriter();
+
+    DebugWriter(const DebugWriter &) = delete;
+    DebugWriter &operator=(const DebugWriter &) = delete;
+
+    // "off", "every_nth" or "on_failure".
+    static std::optional<Mode> parse_mode(std::string_view name);
+
+    // Offers one frame. Raw frames are written as PNG so dumps are lossless,
+    // the annotated frame as JPEG. Returns false if the frame was not queued.
+    bool submit(const FrameHandle &raw, const cv::Mat &detected, bool failed);
+
+    const Options &options() const { return options_; }
+    std::uint64_t written() const { return written_.load(); }
+    std::uint64_t dropped() const { return dropped_.load(); }
+    std::uint64_t errors() const { return errors_.load(); }
+
+  private:
+    struct Job {
+        std::uint64_t index;
+        bool failed;
+        FrameHandle raw;
+        cv::Mat detected;
+    };
+
+    void run();
+    void write(const Job &job);
+
+    const Options options_;
+    std::uint64_t offered_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Job> queue_;
+    bool stop_ = false;
+
+    std::atomic<std::uint64_t> written_{0};
+    std::atomic<std::uint64_t> dropped_{0};
+    std::atomic<std::uint64_t> errors_{0};
+
+    std::thread thread_;
+};
+
+#endif // DEBUG_WRITER_HPP
@@ -0,0 +1,164 @@
+#include "detector_context.hpp"
+#include "alloc_counter.hpp"
+#include "column_argmax.hpp"
+
+#include <algorithm>
+#include <array>
+#include <optional>
+
+namespace {
+
+// Response rows within this many rows of a band edge can still reach the
+// peak fit (two climb steps plus the parabola) and need exact filter input
+// (four rows of vertical support).
+constexpr int kBandHalo = 8;
+
+// First `rows` rows of a full-frame buffer, so band crops of varying height
+// share one allocation.
+cv::Mat head_rows(cv::Mat &buffer, cv::Size full, int type, int rows) {
+    buffer.create(full, type);
+    return buffer.rowRange(0, rows);
+}
+
+} // namespace
+
+void DetectorContext::process(const cv::Mat &input, SegmentResult &out,
+                              const DepthBand *band) {
+    CV_Assert(!input.empty());
+
+    auto buffers = [&]() {
+        return std::array<const void *, 14>{
+            gray_.data,
+            input_f_.data,
+            sub_.data,
+            denoised_.data,
+            response_.data,
+            filter_ws_.rows.data(),
+            peak_rows_.data(),
+            column_sum_.data(),
+            depth_.data(),
+            scratch_.data(),
+            out.image.data,
+            out.coordinates.data(),
+            out.confidence.data(),
+            out.reference.column_mean.data(),
+        };
+    };
+    const auto before = buffers();
+    const std::optional<std::uint64_t> heap_before =
+        thread_allocation_count();
+
+    const cv::Mat *gray = &input;
+    if (input.channels() == 3) {
+        cv::cvtColor(input, gray_, cv::COLOR_BGR2GRAY);
+        gray = &gray_;
+    }
+    const cv::Size full = gray->size();
+    const int cols = full.width;
+
+    bool banded = band && band->lo.size() == static_cast<size_t>(cols) &&
+                  band->hi.size() == static_cast<size_t>(cols) &&
+                  band->reference.column_mean.size() ==
+                      static_cast<size_t>(cols);
+    int row_begin = 0;
+    int row_end = full.height;
+    if (banded) {
+        int lo = *std::min_element(band->lo.begin(), band->lo.end());
+        int hi = *std::max_element(band->hi.begin(), band->hi.end());
+        row_begin = std::max(0, lo - kBandHalo);
+        row_end = std::min(full.height, hi + kBandHalo);
+        banded = row_begin < row_end;
+    }
+    const int rows = row_end - row_begin;
+
+    cv::Mat input_f = head_rows(input_f_, full, CV_32F, rows);
+    cv::Mat sub = head_rows(sub_, full, CV_8U, rows);
+    cv::Mat denoised = head_rows(denoised_, full, CV_8U, rows);
+    filter_ws_.response = head_rows(response_, full, CV_32F, rows);
+
+    const DetectionReference *reference = banded ? &band->reference : nullptr;
+    const NormRange sub_range =
+        bg_sub(gray->rowRange(row_begin, row_end), input_f, sub, row_begin,
+               reference ? &reference->sub : nullptr);
+    const NormRange response_range = spatial_filter_fused(
+        sub, denoised, filter_ws_, reference ? &reference->response : nullptr);
+
+    peak_rows_.resize(cols);
+    out.confidence.resize(cols);
+    if (banded) {
+        band_lo_.resize(cols);
+        band_hi_.resize(cols);
+        for (int x = 0; x < cols; ++x) {
+            int lo = std::clamp(band->lo[x], row_begin, row_end - 1);
+            int hi = std::clamp(band->hi[x], lo + 1, row_end);
+            band_lo_[x] = lo - row_begin;
+            band_hi_[x] = hi - row_begin;
+        }
+        column_argmax_banded(denoised, band_lo_, band_hi_, peak_rows_,
+                             out.confidence, reference->column_mean);
+        out.reference.sub = reference->sub;
+        out.reference.response = reference->response;
+        out.reference.column_mean.assign(reference->column_mean.begin(),
+                                         reference->column_mean.end());
+    } else {
+        column_argmax(denoised, peak_rows_, out.confidence);
+        // The means column_argmax() took its confidence from. cv::reduce
+        // would allocate a row buffer on every call.
+        column_sum_.assign(cols, 0);
+        for (int y = 0; y < rows; ++y) {
+            const std::uint8_t *row = denoised.ptr<std::uint8_t>(y);
+            for (int x = 0; x < cols; ++x) {
+                column_sum_[x] += row[x];
+            }
+        }
+        out.reference.sub = sub_range;
+        out.reference.response = response_range;
+        out.reference.column_mean.resize(cols);
+        const float height = static_cast<float>(rows);
+        for (int x = 0; x < cols; ++x) {
+            out.reference.column_mean[x] =
+                static_cast<float>(column_sum_[x]) / height;
+        }
+    }
+    refine_subpixel(filter_ws_.response, peak_rows_, out.coordinates);
+    for (cv::Point2f &pt : out.coordinates) {
+        pt.y += static_cast<float>(row_begin);
+    }
+
+    // Depths round-trip through float between stages, as the points do.
+    const size_t n = out.coordinates.size();
+    depth_.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        depth_[i] = out.coordinates[i].y;
+    }
+    ol_removal(depth_, scratch_);
+    for (size_t i = 0; i < n; ++i) {
+        float depth = static_cast<float>(depth_[i]);
+        if (depth != out.coordinates[i].y) {
+            out.confidence[i] = 0.0f;
+        }
+        depth_[i] = depth;
+    }
+    kalman_filter_1d(depth_, 0.01, 0.5, scratch_);
+    for (size_t i = 0; i < n; ++i) {
+        out.coordinates[i].y = static_cast<float>(depth_[i]);
+    }
+
+    gray->copyTo(out.image);
+    draw_line(out.image, out.coordinates);
+
+    const auto after = buffers();
+    std::uint64_t grown = 0;
+    for (size_t i = 0; i < before.size(); ++i) {
+        grown += (after[i] != before[i]) ? 1 : 0;
+    }
+    stats_.last_buffer_allocations = grown;
+    stats_.buffer_allocations += stats_.last_buffer_allocations;
+    if (heap_before) {
+        stats_.heap_counted = true;
+        stats_.last_heap_allocations =
+            *thread_allocation_count() - *heap_before;
+        stats_.heap_allocations += stats_.last_heap_allocations;
+    }
+    ++stats_.frames;
+}
@@ -0,0 +1,62 @@
+#ifndef DETECTOR_CONTEXT_HPP
+#define DETECTOR_CONTEXT_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "process_img.hpp"
+#include "spatial_filter.hpp"
+
+// Owns every intermediate buffer of the detect_lines pipeline. Buffers are
+// sized by the first frame and reused afterwards, so once `out` has been
+// filled once, further frames of the same size do not touch the heap.
+//
+// `out.image` and `out.coordinates` are overwritten in place: do not keep
+// references to them (e.g. a queued DebugWriter frame) across calls.
+class DetectorContext {
+  public:
+    struct Stats {
+        std::uint64_t frames = 0;
+        // Times one of the context's or `out`'s buffers was (re)allocated.
+        std::uint64_t buffer_allocations = 0;
+        // Whether operator new calls are counted at all; only when built
+        // with OCTA_COUNT_ALLOCATIONS. Otherwise the heap counters stay 0.
+        bool heap_counted = false;
+        // operator new calls made inside process().
+        std::uint64_t heap_allocations = 0;
+        // Same two counters for the most recent frame only.
+        std::uint64_t last_buffer_allocations = 0;
+        std::uint64_t last_heap_allocations = 0;
+    };
+
+    // With a `band` only the rows it spans (plus a small halo) are filtered
+    // and column x is searched over [band.lo[x], band.hi[x]). Normalisation
+    // and confidence use band.reference rather than the band's own rows, so
+    // the result matches a full-frame pass over the same image wherever the
+    // full-frame peak lies in the band. A full-frame pass measures
+    // out.reference for later bands. Intermediates stay full-frame sized, so
+    // switching between banded and full frames does not reallocate.
+    void process(const cv::Mat &input, SegmentResult &out,
+                 const DepthBand *band = nullptr);
+
+    const Stats &stats() const { return stats_; }
+
+  private:
+    cv::Mat gray_;
+    cv::Mat input_f_;
+    cv::Mat sub_;
+    cv::Mat denoised_;
+    cv::Mat response_;
+    SpatialFilterWorkspace filter_ws_;
+    std::vector<int> peak_rows_;
+    std::vector<int> band_lo_;
+    std::vector<int> band_hi_;
+    std::vector<std::uint32_t> column_sum_;
+    std::vector<double> depth_;
+    std::vector<double> scratch_;
+    Stats stats_;
+};
+
+#endif // DETECTOR_CONTEXT_HPP
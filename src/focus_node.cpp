@@ -4,15 +4,14 @@
  * @brief Node that focuses robot end effector to the normal of the target
  */
 
+#include <atomic>
 #include <cmath>
-#include <condition_variable>
 #include <format>
-#include <mutex>
-#include <open3d/Open3D.h>
-#include <opencv2/img_hash.hpp>
 #include <opencv2/opencv.hpp>
+#include <optional>
 #include <rclcpp/rclcpp.hpp>
 #include <rclcpp_action/rclcpp_action.hpp>
+#include <rclcpp_components/register_node_macro.hpp>
 
 #include <geometry_msgs/msg/pose_stamped.hpp>
 #include <tf2_eigen/tf2_eigen.hpp>
@@ -24,12 +23,23 @@
 
 #include <octa_ros/action/focus.hpp>
 #include <octa_ros/msg/img.hpp>
+#include <octa_ros/msg/img_frame.hpp>
+#include <octa_ros/msg/img_frame_fixed.hpp>
 #include <octa_ros/srv/scan3d.hpp>
 #include <std_srvs/srv/trigger.hpp>
 
 #include <ament_index_cpp/get_package_share_directory.hpp>
 
+#include "background_model.hpp"
+#include "bscan_selector.hpp"
+#include "debug_writer.hpp"
+#include "frame_change_detector.hpp"
+#include "frame_handle.hpp"
+#include "frame_ring.hpp"
+#include "moveit_shared.hpp"
+#include "plane_fit.hpp"
 #include "process_img.hpp"
+#include "surface_accumulator.hpp"
 #include "utils.hpp"
 
 using namespace std::chrono_literals;
@@ -44,9 +54,55 @@ class FocusActionServer : public rclcpp::Node {
         const rclcpp::NodeOptions &options = rclcpp::NodeOptions())
         : Node("focus_action_server",
                rclcpp::NodeOptions(options)
-                   .automatically_declare_parameters_from_overrides(true)) {}
+                   .automatically_declare_parameters_from_overrides(true)) {
+        // init() needs shared_from_this(), which is only valid once the
+        // node is owned by the container or the generated main().
+        init_timer_ = create_wall_timer(0s, [this]() {
+            init_timer_->cancel();
+            init();
+        });
+    }
 
     void init() {
+        DebugWriter::Options debug_options;
+        std::string debug_mode =
+            get_parameter_or<std::string>("debug_images.mode", "off");
+        if (auto mode = DebugWriter::parse_mode(debug_mode)) {
+            debug_options.mode = *mode;
+        } else {
+            RCLCPP_WARN(get_logger(), "Unknown debug_images.mode '%s'",
+                        debug_mode.c_str());
+        }
+        debug_options.every_n = static_cast<int>(
+            get_parameter_or<int64_t>("debug_images.every_n", 1));
+        debug_options.directory = get_parameter_or<std::string>(
+            "debug_images.directory", "focus_debug");
+        debug_writer_ = std::make_unique<DebugWriter>(debug_options);
+
+        interval_ = std::max(
+            2, static_cast<int>(get_parameter_or<int64_t>("bscans.max", 6)));
+        min_bscans_ = std::clamp(
+            static_cast<int>(get_parameter_or<int64_t>("bscans.min", 3)), 3,
+            std::max(3, interval_));
+        adaptive_bscans_ = get_parameter_or<bool>("bscans.adaptive", true);
+        max_failed_fits_ = static_cast<int>(std::clamp<int64_t>(
+            get_parameter_or<int64_t>("plane.max_failed_fits", 3), 1, 100));
+        selector_ = BscanSelector(interval_);
+
+        min_column_confidence_ = static_cast<float>(
+            get_parameter_or<double>("confidence.min_column", 0.02));
+        min_frame_confidence_ = static_cast<float>(
+            get_parameter_or<double>("confidence.min_frame", 0.05));
+
+        if (get_parameter_or<bool>("roi.enabled", true)) {
+            DepthRoiTracker::Options roi_options;
+            roi_options.margin = static_cast<int>(
+                get_parameter_or<int64_t>("roi.margin", 32));
+            roi_options.min_locked_fraction =
+                get_parameter_or<double>("roi.min_locked_fraction", 0.6);
+            roi_tracker_ = std::make_unique<DepthRoiTracker>(roi_options);
+        }
+
         action_server_ = rclcpp_action::create_server<Focus>(
             this, "focus_action",
             std::bind(&FocusActionServer::handle_goal, this,
@@ -56,25 +112,52 @@ class FocusActionServer : public rclcpp::Node {
             std::bind(&FocusActionServer::handle_accepted, this,
                       std::placeholders::_1));
 
-        moveit_cpp_ =
-            std::make_shared<moveit_cpp::MoveItCpp>(shared_from_this());
+        moveit_cpp_ = shared_moveit_cpp(shared_from_this());
         tem_ = moveit_cpp_->getTrajectoryExecutionManagerNonConst();
         planning_component_ = std::make_shared<moveit_cpp::PlanningComponent>(
             "ur_manipulator", moveit_cpp_);
 
         last_store_time_ =
             now() - rclcpp::Duration::from_seconds(gating_interval_);
-        img_subscriber_ = create_subscription<octa_ros::msg::Img>(
-            "oct_image", rclcpp::QoS(rclcpp::KeepLast(10)).best_effort(),
-            std::bind(&FocusActionServer::imageCallback, this,
-                      std::placeholders::_1));
-        img_timer_ = this->create_wall_timer(
-            std::chrono::milliseconds(10),
-            std::bind(&FocusActionServer::imageTimerCallback, this));
-        img_timer_->cancel();
+        // "img" is the legacy 512x500 Img on oct_image; "frame" and "fixed"
+        // are the self-describing ImgFrame and ImgFrameFixed on oct_frame.
+        auto image_qos = rclcpp::QoS(rclcpp::KeepLast(10)).best_effort();
+        std::string image_type =
+            get_parameter_or<std::string>("image.type", "img");
+        if (image_type == "frame") {
+            frame_subscriber_ = create_subscription<octa_ros::msg::ImgFrame>(
+                "oct_frame", image_qos,
+                std::bind(&FocusActionServer::frameCallback, this,
+                          std::placeholders::_1));
+        } else if (image_type == "fixed") {
+            frame_fixed_subscriber_ =
+                create_subscription<octa_ros::msg::ImgFrameFixed>(
+                    "oct_frame", image_qos,
+                    std::bind(&FocusActionServer::frameFixedCallback, this,
+                              std::placeholders::_1));
+        } else {
+            if (image_type != "img") {
+                RCLCPP_WARN(get_logger(),
+                            "Unknown image.type '%s', using 'img'",
+                            image_type.c_str());
+            }
+            img_subscriber_ = create_subscription<octa_ros::msg::Img>(
+                "oct_image", image_qos,
+                std::bind(&FocusActionServer::imageCallback, this,
+                          std::placeholders::_1));
+        }
 
         service_scan_3d_ = create_client<Scan3d>("scan_3d");
 
+        // Loaded once here; after that only capture_background replaces it.
+        const std::string bg_path = BackgroundModel::default_path();
+        if (!BackgroundModel::instance().load(bg_path)) {
+            RCLCPP_WARN(get_logger(),
+                        "Background image %s not available; capture one "
+                        "with capture_background",
+                        bg_path.c_str());
+        }
+
         capture_background_srv_ = create_service<std_srvs::srv::Trigger>(
             "capture_background",
             std::bind(&FocusActionServer::captureBackgroundCallback, this,
@@ -88,22 +171,28 @@ class FocusActionServer : public rclcpp::Node {
     rclcpp_action::Server<Focus>::SharedPtr action_server_;
     std::shared_ptr<GoalHandleFocus> active_goal_handle_;
 
+    rclcpp::TimerBase::SharedPtr init_timer_;
     moveit_cpp::MoveItCppPtr moveit_cpp_;
     std::shared_ptr<moveit_cpp::PlanningComponent> planning_component_;
     std::shared_ptr<trajectory_execution_manager::TrajectoryExecutionManager>
         tem_;
 
-    cv::Mat img_;
-    cv::Mat img_hash_;
+    FrameRing frames_{32};
+    std::atomic<uint64_t> last_read_seq_{0};
+    FrameChangeDetector change_detector_;
     rclcpp::Time last_store_time_;
-    std::mutex img_mutex_;
-    std::condition_variable img_cv_;
     rclcpp::Subscription<octa_ros::msg::Img>::SharedPtr img_subscriber_;
-    rclcpp::TimerBase::SharedPtr img_timer_;
-    uint64_t img_seq_ = 0;
-    uint64_t last_read_seq_ = 0;
-
-    std::vector<cv::Mat> img_array_;
+    rclcpp::Subscription<octa_ros::msg::ImgFrame>::SharedPtr
+        frame_subscriber_;
+    rclcpp::Subscription<octa_ros::msg::ImgFrameFixed>::SharedPtr
+        frame_fixed_subscriber_;
+    std::optional<uint64_t> last_frame_counter_;
+    uint64_t lost_frames_ = 0;
+
+    std::unique_ptr<DebugWriter> debug_writer_;
+    float min_column_confidence_ = 0.02f;
+    float min_frame_confidence_ = 0.05f;
+    std::unique_ptr<DepthRoiTracker> roi_tracker_;
     std::vector<Eigen::Vector3d> pc_lines_;
     Eigen::Matrix3d rotmat_eigen_;
     tf2::Quaternion q_;
@@ -128,9 +217,17 @@ class FocusActionServer : public rclcpp::Node {
     double tmp_yaw_ = 0.0;
 
     const double gating_interval_ = 0.05;
+    // Geometry of legacy Img frames, which do not carry it.
     const int width_ = 500;
     const int height_ = 512;
-    const int interval_ = 6;
+    int interval_ = 6;
+    int min_bscans_ = 3;
+    // Consecutive acquisitions without a usable plane before giving up.
+    int max_failed_fits_ = 3;
+    // Written in init() before any frame arrives; slots are taken by
+    // execute() only.
+    BscanSelector selector_{6};
+    bool adaptive_bscans_ = true;
     const bool single_interval_ = false;
     const double px_per_mm = 55.0;
 
@@ -164,7 +261,6 @@ class FocusActionServer : public rclcpp::Node {
         call_scan3d(false);
         tem_->stopExecution(true);
         planning_component_->setStartStateToCurrentState();
-        img_timer_->cancel();
         RCLCPP_INFO(get_logger(), "Focus action canceled");
         return rclcpp_action::CancelResponse::ACCEPT;
     }
@@ -177,7 +273,6 @@ class FocusActionServer : public rclcpp::Node {
         if (active_goal_handle_ && active_goal_handle_->is_active()) {
             active_goal_handle_->abort(result);
         }
-        img_timer_->reset();
         active_goal_handle_ = goal_handle;
         std::thread([this, goal_handle]() { execute(goal_handle); }).detach();
     }
@@ -224,73 +319,172 @@ class FocusActionServer : public rclcpp::Node {
         return c;
     }
 
-    cv::Mat get_img() {
-        std::unique_lock<std::mutex> lock(img_mutex_);
-        img_cv_.wait(lock, [this]() { return (img_seq_ > last_read_seq_); });
-        last_read_seq_ = img_seq_;
-        return img_.clone();
+    // Next stored frame after the last one read, in arrival order; empty if
+    // none arrives within `timeout`. The returned frame shares the received
+    // message; it is never written.
+    FrameHandle get_img(std::chrono::milliseconds timeout = 100ms) {
+        std::optional<FrameRing::Entry> entry =
+            frames_.wait_next_after(last_read_seq_.load(), timeout);
+        return entry ? consume(*entry) : FrameHandle();
     }
 
-    void imageCallback(const octa_ros::msg::Img::SharedPtr msg) {
-        auto now = this->now();
+    // Up to `count` frames that are already stored after the last one read,
+    // without waiting; frames take_frame() refuses are skipped.
+    std::vector<FrameHandle> get_stored_imgs(std::size_t count) {
+        std::vector<FrameHandle> frames;
+        while (frames.size() < count) {
+            std::optional<FrameRing::Entry> entry =
+                frames_.next_after(last_read_seq_.load());
+            if (!entry) {
+                break;
+            }
+            FrameHandle frame = consume(*entry);
+            if (!frame.empty() && take_frame(frame)) {
+                frames.push_back(std::move(frame));
+            }
+        }
+        return frames;
+    }
+
+    // Marks `entry` read and returns its frame.
+    FrameHandle consume(const FrameRing::Entry &entry) {
+        uint64_t last = last_read_seq_.load();
+        if (entry.seq > last + 1) {
+            RCLCPP_WARN(get_logger(), "Frame ring overran, skipped %lu frames",
+                        static_cast<unsigned long>(entry.seq - last - 1));
+        }
+        last_read_seq_.store(entry.seq);
+        return entry.frame;
+    }
+
+    // A B-scan position already taken this acquisition (from an earlier
+    // sweep of the volume) is not taken again.
+    bool take_frame(const FrameHandle &frame) {
+        const FrameHandle::Info &info = frame.info();
+        if (info.bscan_count < selector_.slots()) {
+            return true;
+        }
+        return selector_.take(info.bscan_index, info.bscan_count) >= 0;
+    }
+
+    // Only frames stored from now on will be returned by get_img().
+    void skip_stored_frames() { last_read_seq_.store(frames_.head()); }
+
+    // Rate-limits stored frames to one per gating_interval_.
+    bool gate(const rclcpp::Time &now) {
         double elapsed = (now - last_store_time_).seconds();
         if (elapsed < gating_interval_) {
-
             RCLCPP_DEBUG(get_logger(),
                          "Skipping frame (%.2f sec since last store)", elapsed);
+            return false;
+        }
+        RCLCPP_DEBUG(get_logger(), "Storing new frame after %.2f sec",
+                     elapsed);
+        return true;
+    }
+
+    void store_frame(FrameHandle frame, const rclcpp::Time &now) {
+        double difference = change_detector_.update(frame.mat());
+        RCLCPP_DEBUG(get_logger(), "Frame difference %.2f%s", difference,
+                     change_detector_.changed() ? "" : " (unchanged)");
+        int64_t stamp_ns = frame.info().stamp_ns != 0 ? frame.info().stamp_ns
+                                                       : now.nanoseconds();
+        if (frames_.publish(std::move(frame), stamp_ns) == 0) {
+            RCLCPP_WARN(get_logger(),
+                        "Frame ring has no free node, dropped frame (%lu in "
+                        "total)",
+                        static_cast<unsigned long>(frames_.dropped()));
+        }
+        last_store_time_ = now;
+    }
+
+    // Frames that report their B-scan position are stored exactly when they
+    // sit at a position the acquisition needs; others (and volumes with
+    // fewer B-scans than slots) fall back to wall-clock gating.
+    bool keep_frame(uint32_t bscan_index, uint32_t bscan_count,
+                    const rclcpp::Time &now) {
+        if (bscan_count >= static_cast<uint32_t>(selector_.slots())) {
+            return selector_.slot(static_cast<int>(bscan_index),
+                                  static_cast<int>(bscan_count)) >= 0;
+        }
+        return gate(now);
+    }
+
+    // Counts frames the publisher sent but we never received.
+    void track_counter(uint64_t counter) {
+        if (last_frame_counter_ && counter > *last_frame_counter_ + 1) {
+            lost_frames_ += counter - *last_frame_counter_ - 1;
+            RCLCPP_WARN(get_logger(),
+                        "Lost %lu frames before #%lu (%lu in total)",
+                        static_cast<unsigned long>(counter -
+                                                   *last_frame_counter_ - 1),
+                        static_cast<unsigned long>(counter),
+                        static_cast<unsigned long>(lost_frames_));
+        }
+        last_frame_counter_ = counter;
+    }
+
+    void imageCallback(const octa_ros::msg::Img::SharedPtr msg) {
+        auto now = this->now();
+        if (!gate(now)) {
             return;
         }
-        RCLCPP_DEBUG(get_logger(),
-                     "Storing new frame after %.2f sec (size=%zu)", elapsed,
-                     msg->img.size());
-        cv::Mat new_img(height_, width_, CV_8UC1);
-        std::copy(msg->img.begin(), msg->img.end(), new_img.data);
-        {
-            std::lock_guard<std::mutex> lock(img_mutex_);
-            img_ = new_img;
-            ++img_seq_;
-            last_store_time_ = now;
-            img_cv_.notify_all();
+        if (msg->img.size() != static_cast<size_t>(height_ * width_)) {
+            RCLCPP_WARN(get_logger(),
+                        "Dropping frame of %zu bytes, expected %d",
+                        msg->img.size(), height_ * width_);
+            return;
         }
+        store_frame(FrameHandle::wrap(msg, msg->img, height_, width_), now);
     }
 
-    void imageTimerCallback() {
-        cv::Mat image_copy;
-        {
-            std::lock_guard<std::mutex> lock(img_mutex_);
-            if (img_.empty()) {
-                RCLCPP_DEBUG(this->get_logger(),
-                             "timerCallback: No image to process");
-                return;
-            }
-            image_copy = img_.clone();
+    void frameCallback(const octa_ros::msg::ImgFrame::SharedPtr msg) {
+        track_counter(msg->frame_counter);
+        auto now = this->now();
+        if (!keep_frame(msg->bscan_index, msg->bscan_count, now)) {
+            return;
         }
-        cv::Mat current_hash;
-        cv::img_hash::AverageHash::create()->compute(image_copy, current_hash);
-        if (img_hash_.empty()) {
-            img_hash_ = current_hash.clone();
-            RCLCPP_DEBUG(this->get_logger(),
-                         "First hash stored. current_hash size=[%dx%d]",
-                         current_hash.rows, current_hash.cols);
+        if (msg->encoding != "mono8" || msg->bit_depth != 8 ||
+            msg->data.size() != static_cast<size_t>(msg->height) * msg->width) {
+            RCLCPP_WARN(get_logger(),
+                        "Dropping %ux%u '%s' frame of %zu bytes; only packed "
+                        "mono8 is supported",
+                        msg->width, msg->height, msg->encoding.c_str(),
+                        msg->data.size());
             return;
         }
-        double diff = 0.0;
-        if (img_hash_.size == current_hash.size &&
-            img_hash_.type() == current_hash.type()) {
-            diff = cv::norm(img_hash_, current_hash);
-            RCLCPP_DEBUG(this->get_logger(),
-                         "Timer triggered - processing. Hash diff=%.2f", diff);
-        } else {
-            RCLCPP_WARN(
-                this->get_logger(),
-                "Hash mismatch in size or type! old=(%d x %d, type=%d), "
-                "new=(%d x %d, type=%d)",
-                img_hash_.rows, img_hash_.cols, img_hash_.type(),
-                current_hash.rows, current_hash.cols, current_hash.type());
+        FrameHandle::Info info;
+        info.stamp_ns = rclcpp::Time(msg->header.stamp).nanoseconds();
+        info.frame_counter = msg->frame_counter;
+        info.bscan_index = static_cast<int>(msg->bscan_index);
+        info.bscan_count = static_cast<int>(msg->bscan_count);
+        store_frame(FrameHandle::wrap(msg, msg->data,
+                                      static_cast<int>(msg->height),
+                                      static_cast<int>(msg->width), info),
+                    now);
+    }
+
+    void
+    frameFixedCallback(const octa_ros::msg::ImgFrameFixed::SharedPtr msg) {
+        track_counter(msg->frame_counter);
+        auto now = this->now();
+        if (!keep_frame(msg->bscan_index, msg->bscan_count, now)) {
+            return;
+        }
+        if (static_cast<size_t>(msg->height) * msg->width > msg->data.size()) {
+            RCLCPP_WARN(get_logger(), "Dropping %ux%u frame over capacity",
+                        msg->width, msg->height);
+            return;
         }
-        RCLCPP_DEBUG(this->get_logger(),
-                     "Timer triggered - final update. Hash diff=%.2f", diff);
-        img_hash_ = current_hash.clone();
+        FrameHandle::Info info;
+        info.stamp_ns = rclcpp::Time(msg->stamp).nanoseconds();
+        info.frame_counter = msg->frame_counter;
+        info.bscan_index = static_cast<int>(msg->bscan_index);
+        info.bscan_count = static_cast<int>(msg->bscan_count);
+        store_frame(FrameHandle::wrap(msg, msg->data,
+                                      static_cast<int>(msg->height),
+                                      static_cast<int>(msg->width), info),
+                    now);
     }
 
     bool call_scan3d(bool activate) {
@@ -319,6 +513,12 @@ class FocusActionServer : public rclcpp::Node {
         goal_handle->publish_feedback(feedback);
         angle_focused_ = false;
         z_focused_ = false;
+        int iterations = 0;
+        int failed_fits = 0;
+        int moves = 0;
+        if (roi_tracker_) {
+            roi_tracker_->reset();
+        }
 
         while (!angle_focused_ || !z_focused_) {
             if (!goal_handle->is_active()) {
@@ -335,7 +535,7 @@ class FocusActionServer : public rclcpp::Node {
                 return;
             }
 
-            img_timer_->reset();
+            ++iterations;
             start = now();
             while (!call_scan3d(true)) {
                 if (!goal_handle->is_active()) {
@@ -360,13 +560,21 @@ class FocusActionServer : public rclcpp::Node {
                 }
                 rclcpp::sleep_for(50ms);
             }
-            img_array_.clear();
+            // Frames stored before the scan started are not part of it.
+            skip_stored_frames();
+            selector_.reset();
+            // Detection runs on the pool while later frames are acquired.
+            SurfaceAccumulator surface(interval_, single_interval_,
+                                       debug_writer_.get());
+            surface.set_confidence_thresholds(min_column_confidence_,
+                                              min_frame_confidence_);
+            surface.set_roi_tracker(roi_tracker_.get());
             for (int i = 0; i < interval_; i++) {
                 start = now();
                 while (true) {
-                    cv::Mat frame = get_img();
-                    if (!img_.empty()) {
-                        img_array_.push_back(frame);
+                    FrameHandle frame = get_img();
+                    if (!frame.empty() && take_frame(frame)) {
+                        surface.submit(frame);
                         break;
                     }
                     if (!goal_handle->is_active()) {
@@ -390,11 +598,47 @@ class FocusActionServer : public rclcpp::Node {
                         return;
                     }
                 }
+                // Frames that arrived while we were busy (e.g. in collect())
+                // are detected together rather than one pool task each.
+                std::vector<FrameHandle> backlog = get_stored_imgs(
+                    static_cast<std::size_t>(interval_ - i - 1));
+                if (!backlog.empty()) {
+                    surface.submit_batch(backlog);
+                    i += static_cast<int>(backlog.size());
+                }
                 msg_ = std::format("Collected image {}", i + 1);
                 RCLCPP_INFO(get_logger(), msg_.c_str());
+
+                // Stop early once the plane is pinned down well enough for
+                // the goal's tolerances.
+                if (adaptive_bscans_ && i + 1 >= min_bscans_ &&
+                    i + 1 < interval_) {
+                    surface.collect();
+                    auto ci = surface.estimator().interval();
+                    if (ci.valid &&
+                        to_degree(ci.roll) < angle_tolerance_ &&
+                        to_degree(ci.pitch) < angle_tolerance_ &&
+                        ci.depth / px_per_mm < z_tolerance_) {
+                        RCLCPP_INFO(get_logger(),
+                                    "Plane converged after %d B-scans "
+                                    "(+/- R:%.3f P:%.3f deg, z:%.4f mm)",
+                                    i + 1, to_degree(ci.roll),
+                                    to_degree(ci.pitch),
+                                    ci.depth / px_per_mm);
+                        break;
+                    }
+                }
             }
 
-            img_timer_->cancel();
+            if (change_detector_.stale()) {
+                RCLCPP_WARN(get_logger(),
+                            "OCT frames stopped changing (%lu of %lu "
+                            "unchanged); is the scan running?",
+                            static_cast<unsigned long>(
+                                change_detector_.unchanged_frames()),
+                            static_cast<unsigned long>(
+                                change_detector_.frames()));
+            }
             start = now();
             while (!call_scan3d(false)) {
                 if (!goal_handle->is_active()) {
@@ -422,14 +666,49 @@ class FocusActionServer : public rclcpp::Node {
             msg_ = "Calculating Rotations";
             RCLCPP_INFO(get_logger(), msg_.c_str());
 
-            pc_lines_ = lines_3d(img_array_, interval_, single_interval_);
-            open3d::geometry::PointCloud pcd_;
-            for (const auto &point : pc_lines_) {
-                pcd_.points_.emplace_back(point);
+            if (surface.estimator().rejected_frames() > 0) {
+                RCLCPP_DEBUG(get_logger(),
+                             "%d frames left out of the plane intervals",
+                             surface.estimator().rejected_frames());
+            }
+            std::vector<double> confidence;
+            pc_lines_ = surface.finish(&confidence);
+            if (surface.rejected_frames() > 0) {
+                RCLCPP_WARN(get_logger(), "Rejected %zu low-confidence frames",
+                            surface.rejected_frames());
+            }
+            if (roi_tracker_) {
+                auto roi = roi_tracker_->stats();
+                RCLCPP_DEBUG(get_logger(),
+                             "Depth ROI: %lu banded, %lu full, %lu lost lock",
+                             static_cast<unsigned long>(roi.banded_frames),
+                             static_cast<unsigned long>(roi.full_frames),
+                             static_cast<unsigned long>(roi.lost_lock));
             }
-            auto boundbox = pcd_.GetMinimalOrientedBoundingBox(false);
-            Eigen::Vector3d center = boundbox.GetCenter();
-            rotmat_eigen_ = align_to_direction(boundbox.R_);
+            PlaneFit plane = fit_plane_robust(pc_lines_, confidence);
+            if (!plane.valid) {
+                if (++failed_fits >= max_failed_fits_) {
+                    RCLCPP_WARN(get_logger(),
+                                "Plane fit failed %d times in a row on %zu "
+                                "points; is there a surface in view?",
+                                failed_fits, plane.points);
+                    result->status = "no surface detected\n";
+                    goal_handle->abort(result);
+                    return;
+                }
+                RCLCPP_WARN(get_logger(),
+                            "Plane fit failed on %zu points, retrying",
+                            plane.points);
+                continue;
+            }
+            failed_fits = 0;
+            RCLCPP_INFO(get_logger(),
+                        "Plane fit: %zu points, %.0f%% inliers, rms %.2f px, "
+                        "max %.2f px",
+                        plane.points, plane.inlier_ratio * 100.0,
+                        plane.rms_residual, plane.max_residual);
+            Eigen::Vector3d center = plane.centroid;
+            rotmat_eigen_ = plane.rotation;
 
             planning_component_->setStartStateToCurrentState();
             moveit::core::RobotStatePtr current_state =
@@ -510,6 +789,7 @@ class FocusActionServer : public rclcpp::Node {
             }
 
             if (planning_) {
+                bool rotating = !angle_focused_;
                 if (!skip_angle_tolerance_) {
                     planning_ = false;
                 }
@@ -564,7 +844,18 @@ class FocusActionServer : public rclcpp::Node {
                     }
                     bool execute_success =
                         moveit_cpp_->execute(plan_solution.trajectory);
+                    if (roi_tracker_) {
+                        // A pure z move shifts the surface by a known
+                        // number of rows; anything else invalidates it.
+                        if (execute_success && !rotating) {
+                            roi_tracker_->shift(static_cast<float>(
+                                dz_ * px_per_mm * 1000.0));
+                        } else {
+                            roi_tracker_->reset();
+                        }
+                    }
                     if (execute_success) {
+                        ++moves;
                         RCLCPP_INFO(get_logger(), "Execute Success!");
                         if (early_terminate_) {
                             angle_focused_ = true;
@@ -602,10 +893,15 @@ class FocusActionServer : public rclcpp::Node {
         }
 
         if (goal_handle->is_active()) {
-            result->status = "Focus completed successfully\n";
+            result->status =
+                std::format("Focus completed successfully ({} iterations, "
+                            "{} moves)\n",
+                            iterations, moves);
             goal_handle->succeed(result);
-            img_timer_->cancel();
-            RCLCPP_INFO(get_logger(), "Focus action completed successfully.");
+            RCLCPP_INFO(get_logger(),
+                        "Focus action completed successfully after %d "
+                        "iterations and %d moves.",
+                        iterations, moves);
         }
     }
 
@@ -613,29 +909,24 @@ class FocusActionServer : public rclcpp::Node {
         [[maybe_unused]] const std::shared_ptr<std_srvs::srv::Trigger::Request>
             request,
         std::shared_ptr<std_srvs::srv::Trigger::Response> response) {
-        img_timer_->reset();
-        cv::Mat frame = get_img();
+        // Runs on the executor that delivers frames, so waiting here would
+        // never see a new one; take the newest stored frame.
+        std::optional<FrameRing::Entry> latest = frames_.latest();
+        FrameHandle frame = latest ? latest->frame : FrameHandle();
         if (!frame.empty()) {
             std::string pkg_share =
                 ament_index_cpp::get_package_share_directory("octa_ros");
             std::string bg_path = pkg_share + "/config/bg.jpg";
-            cv::imwrite(bg_path.c_str(), frame);
-            cv::imwrite("config/bg.jpg", frame);
+            cv::imwrite(bg_path.c_str(), frame.mat());
+            cv::imwrite("config/bg.jpg", frame.mat());
+            BackgroundModel::instance().update(frame.mat());
             response->success = true;
         } else {
             RCLCPP_INFO(get_logger(),
                         "No image captured – background not saved");
             response->success = false;
         }
-        img_timer_->cancel();
     }
 };
 
-int main(int argc, char **argv) {
-    rclcpp::init(argc, argv);
-    auto node = std::make_shared<FocusActionServer>();
-    node->init();
-    rclcpp::spin(node);
-    rclcpp::shutdown();
-    return 0;
-}
+RCLCPP_COMPONENTS_REGISTER_NODE(FocusActionServer)
@@ -0,0 +1,41 @@
+#include "frame_change_detector.hpp"
+
+#include <algorithm>
+#include <limits>
+
+FrameChangeDetector::FrameChangeDetector()
+    : FrameChangeDetector(Options{}) {}
+
+FrameChangeDetector::FrameChangeDetector(Options options)
+    : options_(options) {}
+
+double FrameChangeDetector::update(const cv::Mat &frame) {
+    CV_Assert(!frame.empty());
+    const int block = std::max(1, options_.block);
+    cv::Size size(std::max(1, frame.cols / block),
+                  std::max(1, frame.rows / block));
+    cv::resize(frame, thumb_, size, 0.0, 0.0, cv::INTER_AREA);
+
+    double difference = std::numeric_limits<double>::infinity();
+    if (previous_.size() == thumb_.size() &&
+        previous_.type() == thumb_.type()) {
+        cv::absdiff(thumb_, previous_, diff_);
+        cv::Scalar mean = cv::mean(diff_);
+        difference = 0.0;
+        for (int c = 0; c < thumb_.channels(); ++c) {
+            difference += mean[c];
+        }
+        difference /= thumb_.channels();
+    }
+    std::swap(thumb_, previous_);
+
+    frames_.fetch_add(1);
+    last_difference_.store(difference);
+    if (difference > options_.threshold) {
+        unchanged_run_.store(0);
+    } else {
+        unchanged_run_.fetch_add(1);
+        unchanged_frames_.fetch_add(1);
+    }
+    return difference;
+}
@@ -0,0 +1,51 @@
+#ifndef FRAME_CHANGE_DETECTOR_HPP
+#define FRAME_CHANGE_DETECTOR_HPP
+
+#include <atomic>
+#include <cstdint>
+
+#include <opencv2/opencv.hpp>
+
+// Tells whether a frame differs from the one before it. Each frame is reduced
+// to a block-average thumbnail and compared against the previous thumbnail by
+// mean absolute difference, in grey levels. update() runs once per frame on
+// the thread that receives them and reuses its buffers; the state and
+// counters may be read from any thread.
+class FrameChangeDetector {
+  public:
+    struct Options {
+        // Side of the square blocks averaged into one thumbnail pixel.
+        int block = 8;
+        // Mean absolute thumbnail difference above which a frame is new.
+        double threshold = 1.0;
+        // Consecutive unchanged frames after which the stream is stale.
+        int stale_after = 5;
+    };
+
+    FrameChangeDetector();
+    explicit FrameChangeDetector(Options options);
+
+    // Returns the difference to the previous frame; the first frame, or one
+    // of a different size, counts as changed.
+    double update(const cv::Mat &frame);
+
+    bool changed() const { return unchanged_run_.load() == 0; }
+    bool stale() const { return unchanged_run_.load() >= options_.stale_after; }
+    double last_difference() const { return last_difference_.load(); }
+
+    std::uint64_t frames() const { return frames_.load(); }
+    std::uint64_t unchanged_frames() const { return unchanged_frames_.load(); }
+
+  private:
+    const Options options_;
+    cv::Mat thumb_;
+    cv::Mat previous_;
+    cv::Mat diff_;
+
+    std::atomic<int> unchanged_run_{0};
+    std::atomic<double> last_difference_{0.0};
+    std::atomic<std::uint64_t> frames_{0};
+    std::atomic<std::uint64_t> unchanged_frames_{0};
+};
+
+#endif // FRAME_CHANGE_DETECTOR_HPP
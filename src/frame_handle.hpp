@@ -0,0 +1,71 @@
+#ifndef FRAME_HANDLE_HPP
+#define FRAME_HANDLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <utility>
+
+#include <opencv2/opencv.hpp>
+
+// A read-only image that keeps whatever owns its pixels alive. Wrapping a
+// received message puts a cv::Mat header directly over the message buffer
+// and holds a reference to the message, so a frame can be queued, handed to
+// the thread pool and written to disk without ever copying the pixels.
+//
+// mat() is a view: it does not own the message memory, so keep the handle
+// (not the cv::Mat) alive for as long as the pixels are used, and never
+// write through it.
+class FrameHandle {
+  public:
+    // What the publisher said about the frame, when it said anything.
+    struct Info {
+        std::int64_t stamp_ns = 0;
+        std::uint64_t frame_counter = 0;
+        // -1 if the source does not report the B-scan position.
+        int bscan_index = -1;
+        int bscan_count = 0;
+    };
+
+    FrameHandle() = default;
+
+    // A cv::Mat already shares ownership of its data.
+    FrameHandle(cv::Mat mat) : mat_(std::move(mat)) {}
+
+    // Views the first rows * cols bytes of `data` as a CV_8UC1 image owned
+    // by `message`. Returns an empty handle if `data` is too short.
+    template <class Message>
+    static FrameHandle wrap(std::shared_ptr<Message> message,
+                            std::span<const std::uint8_t> data, int rows,
+                            int cols, Info info = Info()) {
+        FrameHandle frame;
+        if (!message || rows <= 0 || cols <= 0 ||
+            data.size() < static_cast<std::size_t>(rows) *
+                              static_cast<std::size_t>(cols)) {
+            return frame;
+        }
+        frame.mat_ = cv::Mat(rows, cols, CV_8UC1,
+                             const_cast<std::uint8_t *>(data.data()));
+        frame.owner_ = std::move(message);
+        frame.info_ = info;
+        return frame;
+    }
+
+    bool empty() const { return mat_.empty(); }
+    const cv::Mat &mat() const { return mat_; }
+    const Info &info() const { return info_; }
+    operator const cv::Mat &() const { return mat_; }
+
+    void release() {
+        mat_.release();
+        owner_.reset();
+    }
+
+  private:
+    cv::Mat mat_;
+    std::shared_ptr<const void> owner_;
+    Info info_;
+};
+
+#endif // FRAME_HANDLE_HPP
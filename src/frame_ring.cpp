@@ -0,0 +1,174 @@
+#include "frame_ring.hpp"
+
+#include <algorithm>
+
+FrameRing::FrameRing(std::size_t capacity)
+    : slots_(std::max<std::size_t>(1, capacity)) {
+    const std::size_t count = 2 * slots_.size();
+    nodes_ = std::make_unique<Node[]>(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        nodes_[i].next = spare_;
+        spare_ = &nodes_[i];
+    }
+}
+
+FrameRing::Node *FrameRing::pop_free() {
+    if (!spare_) {
+        spare_ = free_.exchange(nullptr, std::memory_order_acquire);
+    }
+    Node *node = spare_;
+    if (node) {
+        spare_ = node->next;
+    }
+    return node;
+}
+
+FrameRing::Node *FrameRing::pin(std::size_t slot) const {
+    Node *node = slots_[slot].load(std::memory_order_acquire);
+    if (!node) {
+        return nullptr;
+    }
+    // A count of zero means the node was replaced and its last reader let
+    // go of it; it may already be on its way back into the ring.
+    std::uint32_t refs = node->refs.load(std::memory_order_relaxed);
+    do {
+        if (refs == 0) {
+            return nullptr;
+        }
+    } while (!node->refs.compare_exchange_weak(refs, refs + 1,
+                                               std::memory_order_acquire,
+                                               std::memory_order_relaxed));
+    return node;
+}
+
+void FrameRing::unpin(Node *node) const {
+    if (node->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+    node->entry.frame.release();
+    Node *head = free_.load(std::memory_order_relaxed);
+    do {
+        node->next = head;
+    } while (!free_.compare_exchange_weak(head, node,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+}
+
+std::uint64_t FrameRing::publish(FrameHandle frame, std::int64_t stamp_ns) {
+    Node *node = pop_free();
+    if (!node) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    const std::uint64_t seq = head_.load(std::memory_order_relaxed) + 1;
+    node->entry.seq = seq;
+    node->entry.stamp_ns = stamp_ns;
+    node->entry.frame = std::move(frame);
+    node->refs.store(1, std::memory_order_release);
+    Node *old = slots_[seq % slots_.size()].exchange(
+        node, std::memory_order_acq_rel);
+    head_.store(seq, std::memory_order_seq_cst);
+    if (old) {
+        unpin(old);
+    }
+
+    // Pairs with the increment in wait_next_after(): either the waiter sees
+    // the new head before sleeping, or we see the waiter and wake it.
+    if (waiters_.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard<std::mutex> lock(wait_mutex_);
+        wait_cv_.notify_all();
+    }
+    return seq;
+}
+
+std::optional<FrameRing::Entry> FrameRing::at(std::uint64_t seq) const {
+    Node *node = pin(seq % slots_.size());
+    if (!node) {
+        return std::nullopt;
+    }
+    std::optional<Entry> entry;
+    if (node->entry.seq == seq) {
+        entry = node->entry;
+    }
+    unpin(node);
+    return entry;
+}
+
+std::optional<FrameRing::Entry> FrameRing::latest() const {
+    // The producer may lap the slot between the two loads; the newest entry
+    // is then simply a later one.
+    const std::uint64_t h = head();
+    if (h == 0) {
+        return std::nullopt;
+    }
+    Node *node = pin(h % slots_.size());
+    if (!node) {
+        return std::nullopt;
+    }
+    std::optional<Entry> entry;
+    if (node->entry.seq >= h) {
+        entry = node->entry;
+    }
+    unpin(node);
+    return entry;
+}
+
+std::optional<FrameRing::Entry>
+FrameRing::next_after(std::uint64_t seq) const {
+    const std::uint64_t n = slots_.size();
+    for (;;) {
+        const std::uint64_t h = head();
+        if (h <= seq) {
+            return std::nullopt;
+        }
+        std::uint64_t first = std::max(seq + 1, h >= n ? h - n + 1 : 1);
+        for (std::uint64_t s = first; s <= h; ++s) {
+            if (std::optional<Entry> entry = at(s)) {
+                return entry;
+            }
+        }
+        // Every candidate was overwritten while we looked; start over from
+        // the new head.
+    }
+}
+
+std::optional<FrameRing::Entry>
+FrameRing::wait_next_after(std::uint64_t seq,
+                           std::chrono::nanoseconds timeout) {
+    if (std::optional<Entry> entry = next_after(seq)) {
+        return entry;
+    }
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(wait_mutex_);
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    wait_cv_.wait_until(lock, deadline, [&]() {
+        return head_.load(std::memory_order_seq_cst) > seq;
+    });
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+    lock.unlock();
+    return next_after(seq);
+}
+
+std::vector<FrameRing::Entry> FrameRing::last(std::size_t count) const {
+    std::vector<Entry> entries;
+    const std::uint64_t h = head();
+    count = std::min<std::size_t>({count, slots_.size(), h});
+    entries.reserve(count);
+    for (std::uint64_t s = h + 1 - count; s <= h && count > 0; ++s) {
+        if (std::optional<Entry> entry = at(s)) {
+            entries.push_back(std::move(*entry));
+        }
+    }
+    return entries;
+}
+
+std::vector<FrameRing::Entry> FrameRing::window(std::int64_t begin_ns,
+                                                std::int64_t end_ns) const {
+    std::vector<Entry> entries;
+    for (Entry &entry : last(slots_.size())) {
+        if (entry.stamp_ns >= begin_ns && entry.stamp_ns < end_ns) {
+            entries.push_back(std::move(entry));
+        }
+    }
+    return entries;
+}
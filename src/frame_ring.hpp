@@ -0,0 +1,107 @@
+#ifndef FRAME_RING_HPP
+#define FRAME_RING_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "frame_handle.hpp"
+
+// The last N received frames, published by one thread (the image
+// subscription) and read by any number of others. Every frame gets the next
+// sequence number, starting at 1.
+//
+// Entries live in a pool of 2N nodes allocated up front. Slot s holds a
+// pointer to the node with sequence number s (mod N). A reader pins the node
+// by raising its reference count (only while it is nonzero), checks that the
+// node still carries the sequence number it asked for, copies the entry out
+// and unpins it. Copying the FrameHandle under a plain seqlock would not be
+// safe: a torn copy could touch a message whose last reference is being
+// dropped. Nodes are never freed while the ring exists, so a stale pointer
+// only ever sees a count of zero or a newer sequence number.
+//
+// publish() neither allocates nor waits for readers: it takes the node it
+// fills from the free list with a single exchange. Readers only pin a node
+// while they copy it, so the N spare nodes are enough in practice; if every
+// one of them is pinned, the frame is dropped and counted instead. The last
+// thread to unpin a replaced node releases its message. publish() touches a
+// mutex only to wake consumers that are sleeping in wait_next_after().
+class FrameRing {
+  public:
+    struct Entry {
+        std::uint64_t seq = 0;
+        std::int64_t stamp_ns = 0;
+        FrameHandle frame;
+    };
+
+    explicit FrameRing(std::size_t capacity = 32);
+
+    std::size_t capacity() const { return slots_.size(); }
+
+    // Single producer only. Returns the frame's sequence number, or 0 if
+    // the frame was dropped because no node was free.
+    std::uint64_t publish(FrameHandle frame, std::int64_t stamp_ns);
+
+    // Sequence number of the newest frame, 0 before the first one.
+    std::uint64_t head() const {
+        return head_.load(std::memory_order_acquire);
+    }
+    // Frames publish() dropped for want of a free node.
+    std::uint64_t dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    std::optional<Entry> latest() const;
+    // Oldest retained frame newer than `seq`, or nothing if there is none
+    // yet. If frames after `seq` were already overwritten the result skips
+    // ahead; compare its seq against seq + 1 to count them.
+    std::optional<Entry> next_after(std::uint64_t seq) const;
+    // As next_after(), but waits up to `timeout` for a frame to arrive.
+    std::optional<Entry> wait_next_after(std::uint64_t seq,
+                                         std::chrono::nanoseconds timeout);
+    // Up to `count` newest frames, oldest first.
+    std::vector<Entry> last(std::size_t count) const;
+    // Retained frames with begin_ns <= stamp_ns < end_ns, oldest first.
+    std::vector<Entry> window(std::int64_t begin_ns,
+                              std::int64_t end_ns) const;
+
+  private:
+    struct Node {
+        // One for the slot that points at the node, one per pinning reader;
+        // zero while the node is free.
+        std::atomic<std::uint32_t> refs{0};
+        Entry entry;
+        Node *next = nullptr;
+    };
+
+    // Entry `seq` if its slot still holds it.
+    std::optional<Entry> at(std::uint64_t seq) const;
+    // Pins the node in `slot`; null if the slot is empty or its node is
+    // being recycled.
+    Node *pin(std::size_t slot) const;
+    void unpin(Node *node) const;
+    // Producer only.
+    Node *pop_free();
+
+    std::unique_ptr<Node[]> nodes_;
+    std::vector<std::atomic<Node *>> slots_;
+    std::atomic<std::uint64_t> head_{0};
+    std::atomic<std::uint64_t> dropped_{0};
+
+    // Nodes unpinned by any thread are pushed onto free_; the producer takes
+    // the whole list at once into spare_, which only it touches.
+    mutable std::atomic<Node *> free_{nullptr};
+    Node *spare_ = nullptr;
+
+    std::atomic<int> waiters_{0};
+    std::mutex wait_mutex_;
+    std::condition_variable wait_cv_;
+};
+
+#endif // FRAME_RING_HPP
@@ -4,9 +4,13 @@
  * @brief Node that move the Z-axis of the TCP
  */
 
+#include <mutex>
+#include <optional>
+
 #include <Eigen/Geometry>
 #include <rclcpp/rclcpp.hpp>
 #include <rclcpp_action/rclcpp_action.hpp>
+#include <rclcpp_components/register_node_macro.hpp>
 
 #include <geometry_msgs/msg/pose_stamped.hpp>
 #include <tf2_eigen/tf2_eigen.hpp>
@@ -24,8 +28,11 @@
 
 #include <octa_ros/action/move_z_angle.hpp>
 
+#include "moveit_shared.hpp"
 #include "utils.hpp"
 
+using namespace std::chrono_literals;
+
 class MoveZAngleActionServer : public rclcpp::Node {
     using MoveZAngle = octa_ros::action::MoveZAngle;
     using GoalHandleMoveZAngle = rclcpp_action::ServerGoalHandle<MoveZAngle>;
@@ -36,10 +43,16 @@ class MoveZAngleActionServer : public rclcpp::Node {
         : Node("move_z_angle_action_server",
                // options
                rclcpp::NodeOptions(options)
-                   .automatically_declare_parameters_from_overrides(true)) {}
+                   .automatically_declare_parameters_from_overrides(true)) {
+        // init() needs shared_from_this(), which is only valid once the
+        // node is owned by the container or the generated main().
+        init_timer_ = create_wall_timer(0s, [this]() {
+            init_timer_->cancel();
+            init();
+        });
+    }
     void init() {
-        moveit_cpp_ =
-            std::make_shared<moveit_cpp::MoveItCpp>(shared_from_this());
+        moveit_cpp_ = shared_moveit_cpp(shared_from_this());
         tem_ = moveit_cpp_->getTrajectoryExecutionManagerNonConst();
         planning_component_ = std::make_shared<moveit_cpp::PlanningComponent>(
             "ur_manipulator", moveit_cpp_);
@@ -60,6 +73,7 @@ class MoveZAngleActionServer : public rclcpp::Node {
     rclcpp_action::Server<MoveZAngle>::SharedPtr action_server_;
     std::shared_ptr<GoalHandleMoveZAngle> active_goal_handle_;
 
+    rclcpp::TimerBase::SharedPtr init_timer_;
     moveit_cpp::MoveItCppPtr moveit_cpp_;
     std::shared_ptr<moveit_cpp::PlanningComponent> planning_component_;
     std::shared_ptr<trajectory_execution_manager::TrajectoryExecutionManager>
@@ -68,6 +82,40 @@ class MoveZAngleActionServer : public rclcpp::Node {
     double radius_ = 0.0;
     double angle_ = 0.0;
 
+    // Made by a plan_only goal, e.g. while the coordinator is still
+    // scanning, and used once by the move that follows.
+    struct CachedPlan {
+        double target_angle;
+        double angle;
+        double radius;
+        moveit::core::RobotStatePtr start;
+        robot_trajectory::RobotTrajectoryPtr trajectory;
+    };
+    std::mutex cache_mutex_;
+    std::optional<CachedPlan> cached_plan_;
+
+    // The cached plan for `goal`, if it was made for the same goal and the
+    // arm is still where the plan starts. The cache is emptied either way.
+    robot_trajectory::RobotTrajectoryPtr
+    take_cached_plan(const MoveZAngle::Goal &goal,
+                     const moveit::core::RobotState &current) {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        if (!cached_plan_) {
+            return nullptr;
+        }
+        CachedPlan plan = std::move(*cached_plan_);
+        cached_plan_.reset();
+        if (plan.target_angle != goal.target_angle ||
+            plan.angle != goal.angle || plan.radius != goal.radius) {
+            return nullptr;
+        }
+        if (plan.start->distance(current) > 1e-3) {
+            RCLCPP_INFO(get_logger(), "Arm moved since planning; replanning");
+            return nullptr;
+        }
+        return plan.trajectory;
+    }
+
     rclcpp_action::GoalResponse
     handle_goal([[maybe_unused]] const rclcpp_action::GoalUUID &uuid,
                 std::shared_ptr<const MoveZAngle::Goal> goal) {
@@ -146,14 +194,41 @@ class MoveZAngleActionServer : public rclcpp::Node {
         return c;
     }
 
+    // Plans from the current state to the goal set on planning_component_,
+    // keeping the shortest of the pipelines' solutions.
+    planning_interface::MotionPlanResponse plan_move() {
+        auto req =
+            moveit_cpp::PlanningComponent::MultiPipelinePlanRequestParameters(
+                shared_from_this(), {"pilz_ptp", "pilz_lin"});
+
+        // auto stop_on_first =
+        //     [](const PlanningComponent::PlanSolutions &sols,
+        //        const auto &) { return sols.hasSuccessfulSolution();
+        //        };
+        auto choose_shortest =
+            [](const std::vector<planning_interface::MotionPlanResponse>
+                   &sols) {
+                return *std::min_element(
+                    sols.begin(), sols.end(), [](const auto &a, const auto &b) {
+                        if (a && b)
+                            return robot_trajectory::pathLength(*a.trajectory) <
+                                   robot_trajectory::pathLength(*b.trajectory);
+                        return static_cast<bool>(a);
+                    });
+            };
+        return planning_component_->plan(req, choose_shortest);
+    }
+
     void execute(const std::shared_ptr<GoalHandleMoveZAngle> goal_handle) {
         RCLCPP_INFO(get_logger(),
                     "Starting Move Z Angle execution with MoveItCpp...");
         auto feedback = std::make_shared<MoveZAngle::Feedback>();
         auto result = std::make_shared<MoveZAngle::Result>();
 
-        double target_angle = goal_handle->get_goal()->target_angle;
-        RCLCPP_INFO(get_logger(), "Target angle: %.2f deg", target_angle);
+        const auto goal = goal_handle->get_goal();
+        double target_angle = goal->target_angle;
+        RCLCPP_INFO(get_logger(), "Target angle: %.2f deg%s", target_angle,
+                    goal->plan_only ? " (plan only)" : "");
 
         if (goal_handle->is_canceling()) {
             feedback->debug_msgs = "MoveZAngle was canceled before starting.\n";
@@ -204,35 +279,32 @@ class MoveZAngleActionServer : public rclcpp::Node {
             return;
         }
 
-        auto req =
-            moveit_cpp::PlanningComponent::MultiPipelinePlanRequestParameters(
-                shared_from_this(), {"pilz_ptp", "pilz_lin"});
+        robot_trajectory::RobotTrajectoryPtr trajectory;
+        if (!goal->plan_only) {
+            trajectory = take_cached_plan(*goal, *cur_state);
+        }
+        if (!trajectory) {
+            planning_interface::MotionPlanResponse plan_solution = plan_move();
+            if (plan_solution.error_code.val !=
+                moveit_msgs::msg::MoveItErrorCodes::SUCCESS) {
+                RCLCPP_WARN(get_logger(), "Planning failed!");
+                feedback->debug_msgs = "Planning failed!\n";
+                feedback->current_z_angle = 0.0;
+                result->status = "Move Z angle failed!\n";
+                goal_handle->publish_feedback(feedback);
+                goal_handle->abort(result);
+                return;
+            }
+            trajectory = plan_solution.trajectory;
+        }
 
-        // auto stop_on_first =
-        //     [](const PlanningComponent::PlanSolutions &sols,
-        //        const auto &) { return sols.hasSuccessfulSolution();
-        //        };
-        auto choose_shortest =
-            [](const std::vector<planning_interface::MotionPlanResponse>
-                   &sols) {
-                return *std::min_element(
-                    sols.begin(), sols.end(), [](const auto &a, const auto &b) {
-                        if (a && b)
-                            return robot_trajectory::pathLength(*a.trajectory) <
-                                   robot_trajectory::pathLength(*b.trajectory);
-                        return static_cast<bool>(a);
-                    });
-            };
-        planning_interface::MotionPlanResponse plan_solution =
-            planning_component_->plan(req, choose_shortest);
-        if (plan_solution.error_code.val !=
-            moveit_msgs::msg::MoveItErrorCodes::SUCCESS) {
-            RCLCPP_WARN(get_logger(), "Planning failed!");
-            feedback->debug_msgs = "Planning failed!\n";
-            feedback->current_z_angle = 0.0;
-            result->status = "Move Z angle failed!\n";
-            goal_handle->publish_feedback(feedback);
-            goal_handle->abort(result);
+        if (goal->plan_only) {
+            std::lock_guard<std::mutex> lock(cache_mutex_);
+            cached_plan_ = CachedPlan{goal->target_angle, goal->angle,
+                                      goal->radius, cur_state, trajectory};
+            result->status = "Move Z Angle planned\n";
+            goal_handle->succeed(result);
+            RCLCPP_INFO(get_logger(), "Move Z Angle plan kept.");
             return;
         }
 
@@ -249,7 +321,7 @@ class MoveZAngleActionServer : public rclcpp::Node {
             return;
         }
 
-        bool execute_success = moveit_cpp_->execute(plan_solution.trajectory);
+        bool execute_success = moveit_cpp_->execute(trajectory);
         if (!execute_success) {
             RCLCPP_ERROR(get_logger(), "Execution failed!");
             feedback->debug_msgs = "Execution failed!\n";
@@ -278,11 +350,4 @@ class MoveZAngleActionServer : public rclcpp::Node {
     }
 };
 
-int main(int argc, char **argv) {
-    rclcpp::init(argc, argv);
-    auto node = std::make_shared<MoveZAngleActionServer>();
-    node->init();
-    rclcpp::spin(node);
-    rclcpp::shutdown();
-    return 0;
-}
+RCLCPP_COMPONENTS_REGISTER_NODE(MoveZAngleActionServer)
@@ -0,0 +1,21 @@
+#include "moveit_shared.hpp"
+
+#include <memory>
+#include <mutex>
+
+moveit_cpp::MoveItCppPtr
+shared_moveit_cpp(const rclcpp::Node::SharedPtr &node) {
+    static std::mutex mutex;
+    static std::weak_ptr<moveit_cpp::MoveItCpp> instance;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    moveit_cpp::MoveItCppPtr moveit_cpp = instance.lock();
+    if (!moveit_cpp) {
+        moveit_cpp = std::make_shared<moveit_cpp::MoveItCpp>(node);
+        instance = moveit_cpp;
+        RCLCPP_INFO(node->get_logger(), "Created shared MoveItCpp");
+    } else {
+        RCLCPP_INFO(node->get_logger(), "Using shared MoveItCpp");
+    }
+    return moveit_cpp;
+}
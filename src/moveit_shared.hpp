@@ -0,0 +1,14 @@
+#ifndef MOVEIT_SHARED_HPP
+#define MOVEIT_SHARED_HPP
+
+#include <moveit/moveit_cpp/moveit_cpp.hpp>
+#include <rclcpp/rclcpp.hpp>
+
+// One MoveItCpp per process. When the action servers are composed into one
+// container they share the robot model, planning scene monitor and joint
+// state subscription instead of each building their own. The first node to
+// ask constructs the instance with its own parameters and interfaces; it is
+// destroyed when the last node holding it goes away.
+moveit_cpp::MoveItCppPtr shared_moveit_cpp(const rclcpp::Node::SharedPtr &node);
+
+#endif // MOVEIT_SHARED_HPP
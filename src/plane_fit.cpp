@@ -0,0 +1,447 @@
+#include "plane_fit.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+
+namespace {
+
+PlaneFit fit_weighted(std::span<const Eigen::Vector3d> points,
+                      std::span<const double> weights) {
+    auto weight = [&](std::size_t i) {
+        return weights.empty() ? 1.0 : weights[i];
+    };
+
+    PlaneFit fit;
+    double total = 0.0;
+    Eigen::Vector3d centroid = Eigen::Vector3d::Zero();
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        double w = weight(i);
+        if (w > 0.0) {
+            centroid += w * points[i];
+            total += w;
+            ++fit.points;
+        }
+    }
+    if (fit.points < 3 || total <= 0.0) {
+        return fit;
+    }
+    centroid /= total;
+
+    Eigen::Matrix3d cov = Eigen::Matrix3d::Zero();
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        double w = weight(i);
+        if (w > 0.0) {
+            Eigen::Vector3d d = points[i] - centroid;
+            cov.noalias() += w * d * d.transpose();
+        }
+    }
+    cov /= total;
+
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(cov);
+    if (solver.info() != Eigen::Success) {
+        return fit;
+    }
+    // Eigenvalues are sorted ascending; a line or a single point has two
+    // vanishing ones and no defined plane.
+    const Eigen::Vector3d &eigenvalues = solver.eigenvalues();
+    if (eigenvalues[1] <= 1e-12 * std::max(1.0, eigenvalues[2])) {
+        return fit;
+    }
+
+    Eigen::Vector3d normal = solver.eigenvectors().col(0);
+    if (normal.z() < 0.0) {
+        normal = -normal;
+    }
+    Eigen::Vector3d u = Eigen::Vector3d::UnitX() - normal.x() * normal;
+    if (u.squaredNorm() < 1e-12) {
+        u = Eigen::Vector3d::UnitY() - normal.y() * normal;
+    }
+    u.normalize();
+    Eigen::Vector3d v = normal.cross(u);
+
+    fit.rotation.col(0) = u;
+    fit.rotation.col(1) = v;
+    fit.rotation.col(2) = normal;
+    fit.centroid = centroid;
+    fit.normal = normal;
+
+    double sum_sq = 0.0;
+    double max_abs = 0.0;
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        double w = weight(i);
+        if (w > 0.0) {
+            double d = normal.dot(points[i] - centroid);
+            sum_sq += w * d * d;
+            max_abs = std::max(max_abs, std::abs(d));
+        }
+    }
+    fit.rms_residual = std::sqrt(sum_sq / total);
+    fit.max_residual = max_abs;
+    fit.valid = true;
+    return fit;
+}
+
+// Two-sided 95% Student-t quantile.
+double t_quantile(int dof) {
+    static constexpr double table[] = {12.706, 4.303, 3.182, 2.776, 2.571,
+                                       2.447,  2.365, 2.306, 2.262, 2.228};
+    if (dof < 1) {
+        return std::numeric_limits<double>::infinity();
+    }
+    return dof <= 10 ? table[dof - 1] : 1.96 + 2.4 / dof;
+}
+
+// Weighted least-squares line depth = my + slope * (x - mx) through the
+// points with a positive weight.
+struct FrameLine {
+    bool valid = false;
+    double mx = 0.0;
+    double my = 0.0;
+    double slope = 0.0;
+
+    double residual(const Eigen::Vector3d &p) const {
+        return p.z() - (my + slope * (p.x() - mx));
+    }
+};
+
+FrameLine fit_line(std::span<const Eigen::Vector3d> points,
+                   std::span<const double> weights) {
+    FrameLine line;
+    double sw = 0.0, sx = 0.0, sy = 0.0;
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        double w = weights[i];
+        if (w > 0.0) {
+            sw += w;
+            sx += w * points[i].x();
+            sy += w * points[i].z();
+        }
+    }
+    if (sw <= 0.0) {
+        return line;
+    }
+    line.mx = sx / sw;
+    line.my = sy / sw;
+    double sxx = 0.0, sxy = 0.0;
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        double w = weights[i];
+        if (w > 0.0) {
+            double dx = points[i].x() - line.mx;
+            sxx += w * dx * dx;
+            sxy += w * dx * (points[i].z() - line.my);
+        }
+    }
+    if (sxx <= 0.0) {
+        return line;
+    }
+    line.slope = sxy / sxx;
+    line.valid = true;
+    return line;
+}
+
+struct Hypothesis {
+    Eigen::Vector3d normal;
+    double offset;
+    int inliers = 0;
+};
+
+} // namespace
+
+PlaneFit fit_plane(std::span<const Eigen::Vector3d> points) {
+    return fit_weighted(points, {});
+}
+
+PlaneFit fit_plane(std::span<const Eigen::Vector3d> points,
+                   std::span<const double> weights) {
+    if (weights.size() != points.size()) {
+        return PlaneFit{};
+    }
+    return fit_weighted(points, weights);
+}
+
+PlaneFit fit_plane_robust(std::span<const Eigen::Vector3d> points,
+                          const RobustPlaneOptions &options,
+                          std::vector<double> *weights) {
+    return fit_plane_robust(points, {}, options, weights);
+}
+
+PlaneFit fit_plane_robust(std::span<const Eigen::Vector3d> points,
+                          std::span<const double> prior,
+                          const RobustPlaneOptions &options,
+                          std::vector<double> *weights) {
+    const std::size_t n = points.size();
+    std::vector<double> local_weights;
+    std::vector<double> &w = weights ? *weights : local_weights;
+    if (!prior.empty() && prior.size() != n) {
+        w.assign(n, 0.0);
+        return PlaneFit{};
+    }
+    auto prior_at = [&](std::size_t i) {
+        return prior.empty() ? 1.0 : std::max(0.0, prior[i]);
+    };
+
+    // Only points with a positive prior take part.
+    std::vector<std::size_t> order;
+    order.reserve(n);
+    w.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        w[i] = prior_at(i);
+        if (w[i] > 0.0) {
+            order.push_back(i);
+        }
+    }
+    const std::size_t m = order.size();
+    if (m < 3) {
+        return fit_weighted(points, w);
+    }
+
+    std::mt19937 rng(options.seed);
+    std::uniform_int_distribution<std::size_t> pick(0, m - 1);
+
+    // Draw minimal-sample hypotheses; degenerate triples are skipped.
+    std::vector<Hypothesis> hypotheses;
+    hypotheses.reserve(options.hypotheses);
+    for (int attempt = 0; attempt < 4 * options.hypotheses &&
+                          static_cast<int>(hypotheses.size()) <
+                              options.hypotheses;
+         ++attempt) {
+        const Eigen::Vector3d &a = points[order[pick(rng)]];
+        const Eigen::Vector3d &b = points[order[pick(rng)]];
+        const Eigen::Vector3d &c = points[order[pick(rng)]];
+        Eigen::Vector3d normal = (b - a).cross(c - a);
+        double norm = normal.norm();
+        if (norm < 1e-9) {
+            continue;
+        }
+        normal /= norm;
+        hypotheses.push_back({normal, normal.dot(a), 0});
+    }
+
+    // Score on a random permutation of the points, block by block, keeping
+    // the better half after each block.
+    std::shuffle(order.begin(), order.end(), rng);
+
+    const double threshold = options.inlier_threshold;
+    const std::size_t block = std::max(1, options.block);
+    std::size_t scored = 0;
+    while (!hypotheses.empty() && scored < m) {
+        std::size_t end = std::min(m, scored + block);
+        for (Hypothesis &h : hypotheses) {
+            for (std::size_t k = scored; k < end; ++k) {
+                const Eigen::Vector3d &p = points[order[k]];
+                if (std::abs(h.normal.dot(p) - h.offset) < threshold) {
+                    ++h.inliers;
+                }
+            }
+        }
+        scored = end;
+        std::sort(hypotheses.begin(), hypotheses.end(),
+                  [](const Hypothesis &x, const Hypothesis &y) {
+                      return x.inliers > y.inliers;
+                  });
+        if (hypotheses.front().inliers >=
+            options.target_inlier_ratio * static_cast<double>(scored)) {
+            break;
+        }
+        if (hypotheses.size() > 1) {
+            hypotheses.resize((hypotheses.size() + 1) / 2);
+        }
+    }
+
+    // Seed weights: hard inliers of the best hypothesis, or the prior alone
+    // if no hypothesis could be formed.
+    if (!hypotheses.empty()) {
+        const Hypothesis &best = hypotheses.front();
+        for (std::size_t i : order) {
+            double r = best.normal.dot(points[i]) - best.offset;
+            w[i] = std::abs(r) < threshold ? prior_at(i) : 0.0;
+        }
+    }
+    PlaneFit fit = fit_weighted(points, w);
+    if (!fit.valid) {
+        for (std::size_t i : order) {
+            w[i] = prior_at(i);
+        }
+        fit = fit_weighted(points, w);
+    }
+
+    // IRLS with Tukey's biweight; the scale comes from the MAD of the
+    // residuals but never drops below a third of the inlier threshold so a
+    // near-perfect fit does not reject sensor noise.
+    std::vector<double> residuals(n, 0.0);
+    std::vector<double> abs_residuals(m);
+    std::vector<double> trial(n, 0.0);
+    for (int it = 0; fit.valid && it < options.irls_iterations; ++it) {
+        for (std::size_t k = 0; k < m; ++k) {
+            std::size_t i = order[k];
+            residuals[i] = fit.normal.dot(points[i] - fit.centroid);
+            abs_residuals[k] = std::abs(residuals[i]);
+        }
+        std::nth_element(abs_residuals.begin(),
+                         abs_residuals.begin() + m / 2, abs_residuals.end());
+        double sigma = std::max(1.4826 * abs_residuals[m / 2], threshold / 3);
+        double c = 4.685 * sigma;
+        for (std::size_t i : order) {
+            double u = residuals[i] / c;
+            double tukey =
+                std::abs(u) < 1.0 ? (1.0 - u * u) * (1.0 - u * u) : 0.0;
+            trial[i] = prior_at(i) * tukey;
+        }
+        PlaneFit next = fit_weighted(points, trial);
+        if (!next.valid) {
+            break;
+        }
+        w.swap(trial);
+        bool converged = next.normal.dot(fit.normal) > 1.0 - 1e-10 &&
+                         std::abs(fit.normal.dot(next.centroid -
+                                                 fit.centroid)) < 1e-6;
+        fit = next;
+        if (converged) {
+            break;
+        }
+    }
+
+    if (fit.valid) {
+        std::size_t inliers = 0;
+        for (std::size_t i : order) {
+            if (std::abs(fit.normal.dot(points[i] - fit.centroid)) <
+                threshold) {
+                ++inliers;
+            }
+        }
+        fit.inlier_ratio =
+            static_cast<double>(inliers) / static_cast<double>(m);
+    }
+    return fit;
+}
+
+FramePlaneEstimator::FramePlaneEstimator() = default;
+
+FramePlaneEstimator::FramePlaneEstimator(Options options)
+    : options_(options) {}
+
+void FramePlaneEstimator::reset() {
+    rejected_frames_ = 0;
+    x_ref_ = 0.0;
+    slopes_.clear();
+    offsets_.clear();
+    z_.clear();
+}
+
+void FramePlaneEstimator::add_frame(std::span<const Eigen::Vector3d> points,
+                                    std::span<const double> weights) {
+    const std::size_t n = points.size();
+    std::vector<double> prior(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        prior[i] = weights.empty() ? 1.0 : std::max(0.0, weights[i]);
+    }
+    std::vector<double> w = prior;
+    FrameLine line = fit_line(points, w);
+
+    // IRLS with Tukey's biweight, scaled as in fit_plane_robust.
+    const double threshold = options_.inlier_threshold;
+    std::vector<double> abs_residuals;
+    abs_residuals.reserve(n);
+    for (int it = 0; line.valid && it < options_.irls_iterations; ++it) {
+        abs_residuals.clear();
+        for (std::size_t i = 0; i < n; ++i) {
+            if (prior[i] > 0.0) {
+                abs_residuals.push_back(std::abs(line.residual(points[i])));
+            }
+        }
+        const std::size_t m = abs_residuals.size();
+        std::nth_element(abs_residuals.begin(),
+                         abs_residuals.begin() + m / 2, abs_residuals.end());
+        double sigma = std::max(1.4826 * abs_residuals[m / 2], threshold / 3);
+        double c = 4.685 * sigma;
+        for (std::size_t i = 0; i < n; ++i) {
+            double u = line.residual(points[i]) / c;
+            double tukey =
+                std::abs(u) < 1.0 ? (1.0 - u * u) * (1.0 - u * u) : 0.0;
+            w[i] = prior[i] * tukey;
+        }
+        FrameLine next = fit_line(points, w);
+        if (!next.valid) {
+            break;
+        }
+        line = next;
+    }
+    if (!line.valid) {
+        return;
+    }
+
+    std::size_t used = 0, inliers = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (prior[i] > 0.0) {
+            ++used;
+            if (std::abs(line.residual(points[i])) < threshold) {
+                ++inliers;
+            }
+        }
+    }
+    if (static_cast<double>(inliers) <
+        options_.min_inlier_ratio * static_cast<double>(used)) {
+        ++rejected_frames_;
+        return;
+    }
+
+    if (slopes_.empty()) {
+        x_ref_ = line.mx;
+    }
+    slopes_.push_back(line.slope);
+    offsets_.push_back(line.my + line.slope * (x_ref_ - line.mx));
+    z_.push_back(points.front().y());
+}
+
+FramePlaneEstimator::Interval FramePlaneEstimator::interval() const {
+    Interval ci;
+    const int n = frames();
+    if (n < 3) {
+        return ci;
+    }
+
+    double mean_slope = 0.0;
+    for (double b : slopes_) {
+        mean_slope += b;
+    }
+    mean_slope /= n;
+    double var_slope = 0.0;
+    for (double b : slopes_) {
+        var_slope += (b - mean_slope) * (b - mean_slope);
+    }
+    var_slope /= n - 1;
+
+    double mz = 0.0, ma = 0.0;
+    for (int i = 0; i < n; ++i) {
+        mz += z_[i];
+        ma += offsets_[i];
+    }
+    mz /= n;
+    ma /= n;
+    double szz = 0.0, sza = 0.0;
+    for (int i = 0; i < n; ++i) {
+        szz += (z_[i] - mz) * (z_[i] - mz);
+        sza += (z_[i] - mz) * (offsets_[i] - ma);
+    }
+    if (szz <= 0.0) {
+        return ci;
+    }
+    double pitch_slope = sza / szz;
+    double rss = 0.0;
+    for (int i = 0; i < n; ++i) {
+        double r = offsets_[i] - (ma + pitch_slope * (z_[i] - mz));
+        rss += r * r;
+    }
+    double s2 = rss / (n - 2);
+
+    // d(atan(s))/ds maps slope uncertainty to angle uncertainty.
+    ci.roll = t_quantile(n - 1) * std::sqrt(var_slope / n) /
+              (1.0 + mean_slope * mean_slope);
+    ci.pitch = t_quantile(n - 2) * std::sqrt(s2 / szz) /
+               (1.0 + pitch_slope * pitch_slope);
+    ci.depth = t_quantile(n - 2) * std::sqrt(s2 / n);
+    ci.valid = true;
+    return ci;
+}
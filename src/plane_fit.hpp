@@ -0,0 +1,116 @@
+#ifndef PLANE_FIT_HPP
+#define PLANE_FIT_HPP
+
+#include <Eigen/Dense>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Least-squares plane through the focus surface points. The normal is the
+// eigenvector of the smallest eigenvalue of the point covariance.
+//
+// `rotation` has the in-plane axis closest to +x in column 0, the normal
+// (oriented towards +z) in column 2 and their cross product in column 1, i.e.
+// the same axis convention align_to_direction() produces for a bounding box.
+struct PlaneFit {
+    bool valid = false;
+    // Points that contributed (non-zero weight).
+    std::size_t points = 0;
+    Eigen::Vector3d centroid = Eigen::Vector3d::Zero();
+    Eigen::Vector3d normal = Eigen::Vector3d::UnitZ();
+    Eigen::Matrix3d rotation = Eigen::Matrix3d::Identity();
+    // Weighted rms and max point-to-plane distance over contributing points,
+    // in the units of the input points.
+    double rms_residual = 0.0;
+    double max_residual = 0.0;
+    // Fraction of input points (with a positive prior) within the inlier
+    // threshold; only set by fit_plane_robust().
+    double inlier_ratio = 1.0;
+};
+
+PlaneFit fit_plane(std::span<const Eigen::Vector3d> points);
+
+// Weighted fit; `weights` must match `points` in size, zero drops a point.
+PlaneFit fit_plane(std::span<const Eigen::Vector3d> points,
+                   std::span<const double> weights);
+
+struct RobustPlaneOptions {
+    // Preemptive RANSAC: all hypotheses are drawn up front, scored on blocks
+    // of points and halved after every block, so the cost is bounded by
+    // roughly 2 * hypotheses * block regardless of the outlier rate.
+    int hypotheses = 64;
+    int block = 100;
+    // Stop scoring once the best hypothesis reaches this inlier ratio.
+    double target_inlier_ratio = 0.9;
+    double inlier_threshold = 3.0;
+    // Tukey-weighted refinement of the RANSAC seed.
+    int irls_iterations = 5;
+    std::uint32_t seed = 0x0C7A;
+};
+
+// RANSAC seed followed by IRLS. `weights`, if given, receives the final
+// per-point weights. A non-empty `prior` (e.g. detection confidence) scales
+// every point's weight; points with a zero prior are ignored entirely.
+PlaneFit fit_plane_robust(std::span<const Eigen::Vector3d> points,
+                          const RobustPlaneOptions &options = {},
+                          std::vector<double> *weights = nullptr);
+PlaneFit fit_plane_robust(std::span<const Eigen::Vector3d> points,
+                          std::span<const double> prior,
+                          const RobustPlaneOptions &options = {},
+                          std::vector<double> *weights = nullptr);
+
+// Running plane estimate built frame by frame, with confidence intervals.
+// Points within one B-scan are strongly correlated (smoothing, neighbouring
+// columns), so each frame is reduced to a weighted line depth = a + b * x and
+// the frames are treated as the independent samples: roll comes from the
+// spread of the per-frame slopes b, pitch and depth from a regression of a
+// across the frames' z positions. Intervals are two-sided 95% Student-t and
+// need at least three frames.
+//
+// Each frame's line is fitted robustly (Tukey IRLS, as in fit_plane_robust),
+// and a frame whose line still leaves too few points within the inlier
+// threshold is rejected: with only a handful of frames, one bad one would
+// otherwise shift or narrow the intervals that decide when to stop.
+class FramePlaneEstimator {
+  public:
+    struct Options {
+        double inlier_threshold = 3.0;
+        double min_inlier_ratio = 0.5;
+        int irls_iterations = 5;
+    };
+    struct Interval {
+        bool valid = false;
+        // Half-widths; roll and pitch in radians, depth in input units.
+        double roll = 0.0;
+        double pitch = 0.0;
+        double depth = 0.0;
+    };
+
+    FramePlaneEstimator();
+    explicit FramePlaneEstimator(Options options);
+
+    void reset();
+
+    // Points of one frame, (x, z, depth) as produced by SurfaceAccumulator;
+    // all share the same z. `weights` (SurfaceAccumulator passes the
+    // detection confidences) scale each point, zero drops it. Frames with
+    // fewer than two usable points are ignored.
+    void add_frame(std::span<const Eigen::Vector3d> points,
+                   std::span<const double> weights = {});
+
+    int frames() const { return static_cast<int>(slopes_.size()); }
+    // Frames whose robust line fit failed since the last reset().
+    int rejected_frames() const { return rejected_frames_; }
+    Interval interval() const;
+
+  private:
+    Options options_;
+    int rejected_frames_ = 0;
+    double x_ref_ = 0.0;
+    std::vector<double> slopes_;
+    std::vector<double> offsets_;
+    std::vector<double> z_;
+};
+
+#endif // PLANE_FIT_HPP
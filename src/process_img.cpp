@@ -1,4 +1,13 @@
 #include "process_img.hpp"
+#include "background_model.hpp"
+#include "column_argmax.hpp"
+#include "detector_context.hpp"
+#include "sliding_median.hpp"
+#include "spatial_filter.hpp"
+#include "surface_accumulator.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
 
 Eigen::Matrix3d align_to_direction(const Eigen::Matrix3d &rot_matrix) {
     Eigen::Matrix3d out_matrix = Eigen::Matrix3d::Zero();
@@ -15,49 +24,101 @@ Eigen::Matrix3d align_to_direction(const Eigen::Matrix3d &rot_matrix) {
     return out_matrix;
 }
 
-void draw_line(cv::Mat &image, const std::vector<cv::Point> &ret_coord) {
-    for (size_t i = 0; i < ret_coord.size() - 1; ++i) {
-        cv::Point pt1 = ret_coord[i];
-        cv::Point pt2 = ret_coord[i + 1];
-        cv::line(image, pt1, pt2, cv::Scalar(255, 255, 255), 2);
+void draw_line(cv::Mat &image, const std::vector<cv::Point2f> &ret_coord) {
+    // Fixed-point drawing keeps the sub-pixel depth visible in debug images.
+    constexpr int shift = 4;
+    constexpr float scale = 1 << shift;
+    for (size_t i = 1; i < ret_coord.size(); ++i) {
+        cv::Point pt1(cvRound(ret_coord[i - 1].x * scale),
+                      cvRound(ret_coord[i - 1].y * scale));
+        cv::Point pt2(cvRound(ret_coord[i].x * scale),
+                      cvRound(ret_coord[i].y * scale));
+        cv::line(image, pt1, pt2, cv::Scalar(255, 255, 255), 2, cv::LINE_8,
+                 shift);
     }
 }
 
-std::vector<cv::Point> get_max_coor(const cv::Mat &img) {
+std::vector<cv::Point> get_max_coor(const cv::Mat &img, int row_begin,
+                                    int row_end) {
     int width = img.cols;
     std::vector<cv::Point> ret_coords(width);
 
+    if (img.type() == CV_8UC1) {
+        std::vector<int> peak_rows(width);
+        column_argmax(img, peak_rows, row_begin, row_end);
+        for (int x = 0; x < width; ++x) {
+            ret_coords[x] = cv::Point(x, peak_rows[x]);
+        }
+        return ret_coords;
+    }
+
+    if (row_end < 0 || row_end > img.rows) {
+        row_end = img.rows;
+    }
+    row_begin = std::clamp(row_begin, 0, row_end - 1);
+    cv::Mat window = img.rowRange(row_begin, row_end);
     for (int x = 0; x < width; ++x) {
-        cv::Mat intensity = img.col(x);
+        cv::Mat intensity = window.col(x);
         double minVal, maxVal;
         cv::Point minLoc, maxLoc;
         cv::minMaxLoc(intensity, &minVal, &maxVal, &minLoc, &maxLoc);
-        int detected_y = maxLoc.y;
+        int detected_y = row_begin + maxLoc.y;
         ret_coords[x] = cv::Point(x, detected_y);
     }
     return ret_coords;
 }
 
-static void medianFilter1D(std::vector<double> &signal, int window_size) {
-    int half_win = window_size / 2;
-    std::vector<double> extended;
-    extended.reserve(signal.size() + 2 * half_win);
-
-    for (int i = 0; i < half_win; ++i)
-        extended.push_back(signal.front());
-    for (double val : signal)
-        extended.push_back(val);
-    for (int i = 0; i < half_win; ++i)
-        extended.push_back(signal.back());
-
-    for (int i = 0; i < (int)signal.size(); ++i) {
-        std::vector<double> window(extended.begin() + i,
-                                   extended.begin() + i + window_size);
-        std::nth_element(window.begin(), window.begin() + window_size / 2,
-                         window.end());
-        double med = window[window_size / 2];
-        signal[i] = med;
+static cv::Point2f refine_peak(const cv::Mat &response, int x, int y) {
+    const int last = response.rows - 1;
+    auto at = [&](int row) { return response.at<float>(row, x); };
+
+    // The 8-bit argmax can land one or two rows off the float peak after
+    // quantisation; climb to the local maximum before fitting.
+    for (int step = 0; step < 2; ++step) {
+        if (y > 0 && at(y - 1) > at(y)) {
+            --y;
+        } else if (y < last && at(y + 1) > at(y)) {
+            ++y;
+        } else {
+            break;
+        }
+    }
+
+    float offset = 0.0f;
+    if (y > 0 && y < last) {
+        float a = at(y - 1);
+        float b = at(y);
+        float c = at(y + 1);
+        float denom = a - 2.0f * b + c;
+        if (denom < 0.0f) {
+            offset = std::clamp(0.5f * (a - c) / denom, -0.5f, 0.5f);
+        }
+    }
+    return cv::Point2f(static_cast<float>(x), y + offset);
+}
+
+std::vector<cv::Point2f> refine_subpixel(const cv::Mat &response,
+                                         const std::vector<cv::Point> &peaks) {
+    CV_Assert(response.type() == CV_32FC1);
+    std::vector<cv::Point2f> refined(peaks.size());
+    for (size_t i = 0; i < peaks.size(); ++i) {
+        refined[i] = refine_peak(response, peaks[i].x, peaks[i].y);
     }
+    return refined;
+}
+
+void refine_subpixel(const cv::Mat &response, std::span<const int> peak_rows,
+                     std::vector<cv::Point2f> &refined) {
+    CV_Assert(response.type() == CV_32FC1);
+    refined.resize(peak_rows.size());
+    for (size_t x = 0; x < peak_rows.size(); ++x) {
+        refined[x] = refine_peak(response, static_cast<int>(x), peak_rows[x]);
+    }
+}
+
+static void medianFilter1D(std::vector<double> &signal, int window_size) {
+    thread_local SlidingMedian filter;
+    median_filter_1d(signal, window_size, filter);
 }
 
 cv::Mat gradient(const cv::Mat &img) {
@@ -135,31 +196,29 @@ cv::Mat lowpass(const cv::Mat &img, int nx, int ny) {
     return dst;
 }
 
-cv::Mat load_bg() {
-    std::string pkg_share =
-        ament_index_cpp::get_package_share_directory("octa_ros");
-    std::string bg_path = pkg_share + "/config/bg.jpg";
-    cv::Mat bg = cv::imread(bg_path, cv::IMREAD_GRAYSCALE);
-    if (bg.empty()) {
-        std::cerr << "Failed to load background image: " << bg_path
-                  << std::endl;
+NormRange bg_sub(const cv::Mat &input, cv::Mat &input_f, cv::Mat &output,
+                 int row_offset, const NormRange *range) {
+    std::shared_ptr<const cv::Mat> bg_f = BackgroundModel::instance().get();
+    CV_Assert(bg_f && input.type() == CV_8UC1 && input.cols == bg_f->cols &&
+              row_offset >= 0 && row_offset + input.rows <= bg_f->rows);
+
+    input.convertTo(input_f, CV_32F);
+    cv::subtract(input_f, bg_f->rowRange(row_offset, row_offset + input.rows),
+                 input_f);
+    NormRange used;
+    if (range) {
+        used = *range;
+    } else {
+        cv::minMaxLoc(input_f, &used.lo, &used.hi);
     }
-    return bg;
+    normalize_u8(input_f, output, used);
+    return used;
 }
 
 cv::Mat bg_sub(const cv::Mat &input) {
-    cv::Mat bg = load_bg();
-    CV_Assert(input.size() == bg.size() && input.type() == bg.type());
-
     cv::Mat input_f;
-    cv::Mat bg_f;
-    input.convertTo(input_f, CV_32F);
-    bg.convertTo(bg_f, CV_32F);
-
-    cv::Mat sub_f = input_f - bg_f;
     cv::Mat output;
-    cv::normalize(sub_f, output, 0, 255, cv::NORM_MINMAX, CV_8U);
-
+    bg_sub(input, input_f, output);
     return output;
 }
 
@@ -212,7 +271,7 @@ cv::Mat bg_sub(const cv::Mat &input) {
 //     return out_8u;
 // }
 
-cv::Mat spatialFilter(cv::Mat &input) {
+cv::Mat spatialFilterReference(const cv::Mat &input) {
 
     cv::Mat raw;
     input.convertTo(raw, CV_32F);
@@ -225,13 +284,24 @@ cv::Mat spatialFilter(cv::Mat &input) {
     return output;
 }
 
-double median(const std::vector<double> &values, int N) {
+cv::Mat spatialFilter(cv::Mat &input) {
+    if (input.type() != CV_8UC1) {
+        return spatialFilterReference(input);
+    }
+    thread_local SpatialFilterWorkspace ws;
+    cv::Mat output;
+    spatial_filter_fused(input, output, ws);
+    return output;
+}
+
+static double median(const std::vector<double> &values, int N,
+                     std::vector<double> &subset) {
     int initCount = std::min(static_cast<int>(values.size()), N);
     if (initCount == 0) {
         return 0.0;
     }
 
-    std::vector<double> subset(values.begin(), values.begin() + initCount);
+    subset.assign(values.begin(), values.begin() + initCount);
     std::sort(subset.begin(), subset.end());
 
     if (initCount % 2 == 1) {
@@ -243,39 +313,31 @@ double median(const std::vector<double> &values, int N) {
     }
 }
 
-std::vector<double> kalmanFilter1D(const std::vector<double> &observations,
-                                   double Q = 0.01, double R = 0.5) {
-    std::vector<double> x_k_estimates;
-    x_k_estimates.reserve(observations.size());
+void kalman_filter_1d(std::vector<double> &observations, double Q, double R,
+                      std::vector<double> &scratch) {
     if (observations.empty()) {
-        return x_k_estimates;
+        return;
     }
 
-    double x0 = median(observations, 10);
+    double x0 = median(observations, 10, scratch);
     double x_k = x0;
     double P_k = 1.0;
 
-    for (double z_k : observations) {
+    for (double &z_k : observations) {
         double x_k_pred = x_k;
         double P_k_pred = P_k + Q;
         double K_k = P_k_pred / (P_k_pred + R);
         x_k = x_k_pred + K_k * (z_k - x_k_pred);
         P_k = (1.0 - K_k) * P_k_pred;
 
-        x_k_estimates.push_back(x_k);
+        z_k = x_k;
     }
-    return x_k_estimates;
 }
 
-std::vector<cv::Point> ol_removal(const std::vector<cv::Point> &coords) {
-    if (coords.empty()) {
-        return {};
-    }
-
-    std::vector<double> observations;
-    observations.reserve(coords.size());
-    for (auto &pt : coords) {
-        observations.push_back(pt.y);
+void ol_removal(std::vector<double> &observations,
+                std::vector<double> &segment) {
+    if (observations.empty()) {
+        return;
     }
 
     int obs_length = (int)observations.size();
@@ -293,8 +355,8 @@ std::vector<cv::Point> ol_removal(const std::vector<cv::Point> &coords) {
             continue;
         }
 
-        std::vector<double> segment(observations.begin() + start,
-                                    observations.begin() + end);
+        segment.assign(observations.begin() + start,
+                       observations.begin() + end);
 
         double meanVal = std::accumulate(segment.begin(), segment.end(), 0.0) /
                          segment.size();
@@ -317,12 +379,11 @@ std::vector<cv::Point> ol_removal(const std::vector<cv::Point> &coords) {
     for (int i = 0; i < obs_length; ++i) {
         if (i == 0) {
             int end = std::min(20, obs_length);
-            std::vector<double> firstChunk(observations.begin(),
-                                           observations.begin() + end);
-            std::nth_element(firstChunk.begin(),
-                             firstChunk.begin() + firstChunk.size() / 2,
-                             firstChunk.end());
-            observations[0] = firstChunk[firstChunk.size() / 2];
+            segment.assign(observations.begin(), observations.begin() + end);
+            std::nth_element(segment.begin(),
+                             segment.begin() + segment.size() / 2,
+                             segment.end());
+            observations[0] = segment[segment.size() / 2];
         } else {
             double prev_pt = observations[i - 1];
             double pt = observations[i];
@@ -332,90 +393,174 @@ std::vector<cv::Point> ol_removal(const std::vector<cv::Point> &coords) {
             }
         }
     }
+}
 
-    std::vector<cv::Point> new_coords;
-    new_coords.reserve(coords.size());
-    for (int i = 0; i < obs_length; ++i) {
-        new_coords.push_back(
-            cv::Point(coords[i].x, (int)std::round(observations[i])));
-    }
-    return new_coords;
+static DetectorContext &detector_context() {
+    thread_local DetectorContext context;
+    return context;
 }
 
 SegmentResult detect_lines(const cv::Mat &inputImg) {
-    CV_Assert(!inputImg.empty());
+    SegmentResult result;
+    detector_context().process(inputImg, result);
+    return result;
+}
 
-    cv::Mat img_raw;
-    if (inputImg.channels() == 3) {
-        cv::cvtColor(inputImg, img_raw, cv::COLOR_BGR2GRAY);
-    } else {
-        img_raw = inputImg.clone();
-    }
+DepthRoiTracker::DepthRoiTracker() : DepthRoiTracker(Options{}) {}
+
+DepthRoiTracker::DepthRoiTracker(Options options) : options_(options) {}
 
-    cv::Mat sub_image = bg_sub(img_raw);
-    cv::Mat denoised_image = spatialFilter(sub_image);
+void DepthRoiTracker::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    profiles_.clear();
+    reference_.column_mean.clear();
+}
+
+void DepthRoiTracker::shift(float rows) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::vector<float> &profile : profiles_) {
+        for (float &depth : profile) {
+            depth += rows;
+        }
+    }
+}
 
-    std::vector<cv::Point> ret_coords = get_max_coor(denoised_image);
+bool DepthRoiTracker::band(int index, int rows, int cols,
+                           DepthBand &band) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (reference_.column_mean.size() != static_cast<size_t>(cols)) {
+        return false;
+    }
+    const std::vector<float> *profile = nullptr;
+    int best = -1;
+    for (size_t i = 0; i < profiles_.size(); ++i) {
+        int distance = std::abs(static_cast<int>(i) - index);
+        if (profiles_[i].size() == static_cast<size_t>(cols) &&
+            (!profile || distance < best)) {
+            profile = &profiles_[i];
+            best = distance;
+        }
+    }
+    if (!profile) {
+        return false;
+    }
 
-    // std::vector<double> ys;
-    // ys.reserve(ret_coords.size());
-    // for (const auto &pt : ret_coords)
-    //     ys.push_back(static_cast<double>(pt.y));
-    // medianFilter1D(ys, 15);
-    // for (std::size_t i = 0; i < ret_coords.size(); ++i)
-    //     ret_coords[i].y = static_cast<int>(std::round(ys[i]));
+    band.lo.resize(cols);
+    band.hi.resize(cols);
+    for (int x = 0; x < cols; ++x) {
+        int depth = static_cast<int>(std::lround((*profile)[x]));
+        int lo = std::clamp(depth - options_.margin, 0, rows - 1);
+        int hi = std::clamp(depth + options_.margin + 1, lo + 1, rows);
+        band.lo[x] = lo;
+        band.hi[x] = hi;
+    }
+    band.reference = reference_;
+    return true;
+}
 
-    ret_coords = ol_removal(ret_coords);
+bool DepthRoiTracker::locked(const DepthBand &band,
+                             const SegmentResult &result) const {
+    const size_t cols = result.coordinates.size();
+    if (cols == 0 || band.lo.size() != cols) {
+        return false;
+    }
+    // A peak within a row of the band edge most likely belongs to a surface
+    // outside the band.
+    size_t good = 0;
+    for (size_t x = 0; x < cols; ++x) {
+        float y = result.coordinates[x].y;
+        if (result.confidence[x] >= options_.min_confidence &&
+            y > static_cast<float>(band.lo[x] + 1) &&
+            y < static_cast<float>(band.hi[x] - 2)) {
+            ++good;
+        }
+    }
+    return static_cast<double>(good) >=
+           options_.min_locked_fraction * static_cast<double>(cols);
+}
 
-    std::vector<double> obs;
-    obs.reserve(ret_coords.size());
-    for (auto &pt : ret_coords) {
-        obs.push_back(pt.y);
+void DepthRoiTracker::update(int index, const SegmentResult &result,
+                             bool banded, bool lost_lock) {
+    const size_t cols = result.coordinates.size();
+    size_t confident = 0;
+    for (size_t x = 0; x < cols; ++x) {
+        if (result.confidence[x] >= options_.min_confidence) {
+            ++confident;
+        }
+    }
+    bool keep = cols > 0 && static_cast<double>(confident) >=
+                                options_.min_locked_fraction *
+                                    static_cast<double>(cols);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++(banded ? stats_.banded_frames : stats_.full_frames);
+    if (lost_lock) {
+        ++stats_.lost_lock;
+    }
+    if (!banded && result.reference.column_mean.size() == cols) {
+        reference_ = result.reference;
     }
-    std::vector<double> kf_out = kalmanFilter1D(obs, 0.01, 0.5);
-    for (size_t i = 0; i < ret_coords.size(); ++i) {
-        ret_coords[i].y = static_cast<int>(std::round(kf_out[i]));
+    if (index < 0) {
+        return;
     }
+    if (profiles_.size() <= static_cast<size_t>(index)) {
+        profiles_.resize(index + 1);
+    }
+    std::vector<float> &profile = profiles_[index];
+    if (!keep) {
+        profile.clear();
+        return;
+    }
+    // The detected line is already outlier-filtered and smoothed across
+    // columns, so it is a usable prediction even where confidence is low.
+    profile.resize(cols);
+    for (size_t x = 0; x < cols; ++x) {
+        profile[x] = result.coordinates[x].y;
+    }
+}
 
-    cv::Mat detected_img = img_raw.clone();
-    draw_line(detected_img, ret_coords);
+DepthRoiTracker::Stats DepthRoiTracker::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
 
+SegmentResult detect_lines_tracked(const cv::Mat &inputImg,
+                                   DepthRoiTracker &tracker, int frame_index) {
+    thread_local DepthBand band;
+    DetectorContext &context = detector_context();
     SegmentResult result;
-    result.image = detected_img;
-    result.coordinates = ret_coords;
+    bool banded =
+        tracker.band(frame_index, inputImg.rows, inputImg.cols, band);
+    bool lost_lock = false;
+    if (banded) {
+        context.process(inputImg, result, &band);
+        lost_lock = !tracker.locked(band, result);
+    }
+    if (!banded || lost_lock) {
+        context.process(inputImg, result);
+    }
+    tracker.update(frame_index, result, banded && !lost_lock, lost_lock);
     return result;
 }
 
+std::vector<SegmentResult>
+detect_lines_batch(std::span<const cv::Mat> frames, DepthRoiTracker *tracker,
+                   std::span<const int> frame_indices) {
+    std::vector<SegmentResult> results(frames.size());
+    ThreadPool::shared().parallel_for(frames.size(), [&](size_t i) {
+        results[i] = tracker ? detect_lines_tracked(frames[i], *tracker,
+                                                    frame_indices[i])
+                             : detect_lines(frames[i]);
+    });
+    return results;
+}
+
 std::vector<Eigen::Vector3d> lines_3d(const std::vector<cv::Mat> &img_array,
                                       const int interval,
-                                      const bool acq_interval) {
-    std::vector<Eigen::Vector3d> pc_3d;
-    int num_frames = interval > 1 ? interval : 2;
-    double increments = 499.0 / static_cast<double>(num_frames - 1);
-
-    for (size_t i = 0; i < img_array.size(); ++i) {
-        cv::Mat img = img_array[i];
-        std::string raw_filename = std::format("raw_image{}.jpg", i);
-        cv::imwrite(raw_filename.c_str(), img);
-        SegmentResult pc = detect_lines(img);
-        std::string processed_filename = std::format("detected_image{}.jpg", i);
-        cv::imwrite(processed_filename.c_str(), pc.image);
-        assert(!pc.coordinates.empty());
-
-        int idx = static_cast<int>(i) % interval;
-        double z_val = idx * increments;
-
-        for (size_t j = 0; j < pc.coordinates.size(); ++j) {
-            double x = static_cast<double>(pc.coordinates[j].x);
-            double y = static_cast<double>(pc.coordinates[j].y);
-            pc_3d.emplace_back(Eigen::Vector3d(x, z_val, y));
-            // pc_3d.emplace_back(Eigen::Vector3d(-y, z_val, x));
-        }
-
-        if (acq_interval && pc_3d.size() >= static_cast<size_t>(interval)) {
-            break;
-        }
-    }
-
-    return pc_3d;
+                                      const bool acq_interval,
+                                      DebugWriter *debug) {
+    SurfaceAccumulator surface(interval, acq_interval, debug);
+    std::vector<FrameHandle> frames(img_array.begin(), img_array.end());
+    surface.submit_batch(frames);
+    return surface.finish();
 }
@@ -4,24 +4,149 @@
 #include <Eigen/Dense>
 #include <ament_index_cpp/get_package_share_directory.hpp>
 #include <cmath>
-#include <open3d/Open3D.h>
+#include <cstdint>
+#include <mutex>
 #include <opencv2/opencv.hpp>
+#include <span>
+#include <vector>
+
+#include "spatial_filter.hpp"
+
+class DebugWriter;
+
+// The frame-level quantities of a full-frame detection. A banded detection
+// sees too few rows to measure them and borrows those of the last full frame
+// instead, so banded and full-frame detection of the same image agree and
+// their confidences can share thresholds.
+struct DetectionReference {
+    // Ranges mapped to 0..255 after background subtraction and after the
+    // spatial filter.
+    NormRange sub;
+    NormRange response;
+    // Mean of each full column of the filtered 8-bit image, the baseline of
+    // the column confidence.
+    std::vector<float> column_mean;
+};
 
 struct SegmentResult {
     cv::Mat image;
-    std::vector<cv::Point> coordinates;
+    std::vector<cv::Point2f> coordinates;
+    // Per coordinate, (peak - column mean) / 255 of the filtered image; zero
+    // where ol_removal replaced the detected depth.
+    std::vector<float> confidence;
+    // Measured on a full frame, copied from the band on a banded one.
+    DetectionReference reference;
+};
+
+// Per-column search window [lo[x], hi[x]) in full-frame rows, and the
+// full-frame reference to detect it with.
+struct DepthBand {
+    std::vector<int> lo;
+    std::vector<int> hi;
+    DetectionReference reference;
+};
+
+// Predicts where the surface will be in the next frame from the depth
+// profiles already detected, so detection can skip the rows far from it.
+// Profiles are kept per B-scan index (frame position within a sweep); an
+// index not seen yet borrows the nearest known one, since neighbouring
+// B-scans of a sweep are close. The reference of the last full frame is
+// handed out with every band. Shared by the pool workers of one
+// acquisition, hence the lock.
+class DepthRoiTracker {
+  public:
+    struct Options {
+        // Rows searched on either side of the predicted depth.
+        int margin = 32;
+        // Columns below this confidence do not count as locked.
+        float min_confidence = 0.1f;
+        // A frame keeps lock if at least this fraction of its columns are
+        // confident and not pinned to a band edge; otherwise it is redone
+        // on the full frame and its profile is only kept if that succeeds.
+        double min_locked_fraction = 0.6;
+    };
+    struct Stats {
+        std::uint64_t banded_frames = 0;
+        std::uint64_t full_frames = 0;
+        // Banded frames that lost lock and were redone on the full frame.
+        std::uint64_t lost_lock = 0;
+    };
+
+    DepthRoiTracker();
+    explicit DepthRoiTracker(Options options);
+
+    // Forget every profile, e.g. after the probe was rotated.
+    void reset();
+    // Move every profile by `rows`, e.g. after a known z move.
+    void shift(float rows);
+
+    // False if no profile or no full-frame reference is known yet; the
+    // frame must then be searched in full.
+    bool band(int index, int rows, int cols, DepthBand &band) const;
+    bool locked(const DepthBand &band, const SegmentResult &result) const;
+    void update(int index, const SegmentResult &result, bool banded,
+                bool lost_lock);
+
+    Stats stats() const;
+
+  private:
+    Options options_;
+    mutable std::mutex mutex_;
+    std::vector<std::vector<float>> profiles_;
+    DetectionReference reference_;
+    Stats stats_;
 };
 
-void draw_line(cv::Mat &image, const std::vector<cv::Point> &ret_coord);
+void draw_line(cv::Mat &image, const std::vector<cv::Point2f> &ret_coord);
 
 Eigen::Matrix3d align_to_direction(const Eigen::Matrix3d &rot_matrix);
 
-std::vector<cv::Point> get_max_coor(const cv::Mat &img);
+std::vector<cv::Point> get_max_coor(const cv::Mat &img, int row_begin = 0,
+                                    int row_end = -1);
+
+// Parabolic fit of the float filter response around each column's peak.
+std::vector<cv::Point2f> refine_subpixel(const cv::Mat &response,
+                                         const std::vector<cv::Point> &peaks);
+void refine_subpixel(const cv::Mat &response, std::span<const int> peak_rows,
+                     std::vector<cv::Point2f> &refined);
+
+// Background subtraction into caller-owned buffers; `input_f` is scratch.
+// `input` may be a band of rows starting at `row_offset` of the full frame.
+// The difference is min-max normalised to 8 bits, from `range` if given.
+// Returns the range used.
+NormRange bg_sub(const cv::Mat &input, cv::Mat &input_f, cv::Mat &output,
+                 int row_offset = 0, const NormRange *range = nullptr);
+
+// In-place variants of the depth clean-up steps used by detect_lines.
+// `scratch` is reused between calls so steady-state use does not allocate.
+void ol_removal(std::vector<double> &observations,
+                std::vector<double> &scratch);
+void kalman_filter_1d(std::vector<double> &observations, double Q, double R,
+                      std::vector<double> &scratch);
+
+cv::Mat spatialFilter(cv::Mat &input);
+
+cv::Mat spatialFilterReference(const cv::Mat &input);
 
 SegmentResult detect_lines(const cv::Mat &inputImg);
 
+// detect_lines restricted to the band `tracker` predicts for B-scan
+// `frame_index`, falling back to the full frame when there is no prediction
+// or the banded result lost lock. The result feeds back into the tracker.
+SegmentResult detect_lines_tracked(const cv::Mat &inputImg,
+                                   DepthRoiTracker &tracker, int frame_index);
+
+// Runs detect_lines on every frame concurrently on the shared thread pool;
+// results are returned in input order. With a tracker, frame i is detected
+// by detect_lines_tracked as B-scan `frame_indices[i]` instead.
+std::vector<SegmentResult>
+detect_lines_batch(std::span<const cv::Mat> frames,
+                   DepthRoiTracker *tracker = nullptr,
+                   std::span<const int> frame_indices = {});
+
 std::vector<Eigen::Vector3d> lines_3d(const std::vector<cv::Mat> &img_array,
                                       const int interval,
-                                      const bool acq_interval = false);
+                                      const bool acq_interval = false,
+                                      DebugWriter *debug = nullptr);
 
 #endif // PROCESS_IMG_HPP
@@ -6,6 +6,7 @@
 
 #include <rclcpp/rclcpp.hpp>
 #include <rclcpp_action/rclcpp_action.hpp>
+#include <rclcpp_components/register_node_macro.hpp>
 
 #include <algorithm>
 #include <chrono>
@@ -25,6 +26,7 @@
 #include <moveit_msgs/msg/position_constraint.hpp>
 #include <shape_msgs/msg/solid_primitive.hpp>
 
+#include "moveit_shared.hpp"
 #include "utils.hpp"
 
 using namespace std::chrono_literals;
@@ -38,7 +40,14 @@ class ResetActionServer : public rclcpp::Node {
         const rclcpp::NodeOptions &options = rclcpp::NodeOptions())
         : Node("reset_action_server",
                rclcpp::NodeOptions(options)
-                   .automatically_declare_parameters_from_overrides(true)) {}
+                   .automatically_declare_parameters_from_overrides(true)) {
+        // init() needs shared_from_this(), which is only valid once the
+        // node is owned by the container or the generated main().
+        init_timer_ = create_wall_timer(0s, [this]() {
+            init_timer_->cancel();
+            init();
+        });
+    }
     void init() {
         action_server_ = rclcpp_action::create_server<ResetAction>(
             this, "reset_action",
@@ -53,8 +62,7 @@ class ResetActionServer : public rclcpp::Node {
 
         publisher_ = this->create_publisher<std_msgs::msg::String>(
             "/urscript_interface/script_command", qos);
-        moveit_cpp_ =
-            std::make_shared<moveit_cpp::MoveItCpp>(shared_from_this());
+        moveit_cpp_ = shared_moveit_cpp(shared_from_this());
         tem_ = moveit_cpp_->getTrajectoryExecutionManagerNonConst();
         planning_component_ = std::make_shared<moveit_cpp::PlanningComponent>(
             "ur_manipulator", moveit_cpp_);
@@ -63,6 +71,7 @@ class ResetActionServer : public rclcpp::Node {
   private:
     rclcpp_action::Server<ResetAction>::SharedPtr action_server_;
     std::shared_ptr<GoalHandleResetAction> active_goal_handle_;
+    rclcpp::TimerBase::SharedPtr init_timer_;
     moveit_cpp::MoveItCppPtr moveit_cpp_;
     std::shared_ptr<moveit_cpp::PlanningComponent> planning_component_;
     std::shared_ptr<trajectory_execution_manager::TrajectoryExecutionManager>
@@ -317,11 +326,4 @@ class ResetActionServer : public rclcpp::Node {
     }
 };
 
-int main(int argc, char **argv) {
-    rclcpp::init(argc, argv);
-    auto node = std::make_shared<ResetActionServer>();
-    node->init();
-    rclcpp::spin(node);
-    rclcpp::shutdown();
-    return 0;
-}
+RCLCPP_COMPONENTS_REGISTER_NODE(ResetActionServer)
@@ -0,0 +1,217 @@
+#include "scan_pipeline.hpp"
+
+#include <algorithm>
+
+namespace {
+
+void depend_on(std::vector<std::size_t> &deps,
+               const std::optional<std::size_t> &task) {
+    if (task && std::find(deps.begin(), deps.end(), *task) == deps.end()) {
+        deps.push_back(*task);
+    }
+}
+
+} // namespace
+
+ScanPipeline::ScanPipeline(std::span<const Step> recipe, bool pipelined)
+    : pipelined_(pipelined), steps_(recipe.size()) {
+    // Mode LabVIEW will be in once the tasks so far have run; unknown at
+    // the start, so the first step always configures.
+    std::optional<Mode> configured;
+
+    if (!pipelined_) {
+        std::optional<std::size_t> last;
+        auto chain = [&](Kind kind, Mode mode, double arg, std::size_t step) {
+            std::vector<std::size_t> deps;
+            depend_on(deps, last);
+            last = add(kind, mode, arg, step, std::move(deps));
+        };
+        for (std::size_t i = 0; i < recipe.size(); ++i) {
+            const Step &step = recipe[i];
+            if (configured != step.mode) {
+                chain(Kind::Configure, step.mode, 0.0, i);
+                configured = step.mode;
+            }
+            switch (step.action) {
+            case UserAction::Focus:
+                chain(Kind::Focus, step.mode, 0.0, i);
+                break;
+            case UserAction::MoveZangle:
+                chain(Kind::Move, step.mode, step.arg, i);
+                break;
+            case UserAction::Scan:
+                chain(Kind::Scan, step.mode, 0.0, i);
+                break;
+            default:
+                break;
+            }
+        }
+        return;
+    }
+
+    // Last task that used the imaging side, the last acquisition (which the
+    // arm must not disturb) and the last task that moved the arm.
+    std::optional<std::size_t> imaging;
+    std::optional<std::size_t> acquisition;
+    std::optional<std::size_t> arm;
+
+    auto configure = [&](Mode mode, std::size_t step) {
+        if (configured == mode) {
+            return;
+        }
+        std::vector<std::size_t> deps;
+        depend_on(deps, imaging);
+        imaging = add(Kind::Configure, mode, 0.0, step, std::move(deps));
+        configured = mode;
+    };
+
+    for (std::size_t i = 0; i < recipe.size(); ++i) {
+        const Step &step = recipe[i];
+        switch (step.action) {
+        case UserAction::Focus: {
+            configure(step.mode, i);
+            std::vector<std::size_t> deps;
+            depend_on(deps, imaging);
+            depend_on(deps, arm);
+            const std::size_t id =
+                add(Kind::Focus, step.mode, 0.0, i, std::move(deps));
+            imaging = acquisition = arm = id;
+            break;
+        }
+        case UserAction::MoveZangle: {
+            // Focus needs the arm to stay where it ends up, so only imaging
+            // modes are configured during the move.
+            if (step.mode != Mode::ROBOT) {
+                configure(step.mode, i);
+            }
+            std::vector<std::size_t> plan_deps;
+            depend_on(plan_deps, arm);
+            const std::size_t plan = add(Kind::PlanMove, step.mode, step.arg,
+                                         i, std::move(plan_deps));
+            std::vector<std::size_t> deps{plan};
+            depend_on(deps, arm);
+            depend_on(deps, acquisition);
+            arm = add(Kind::Move, step.mode, step.arg, i, std::move(deps));
+            break;
+        }
+        case UserAction::Scan: {
+            configure(step.mode, i);
+            std::vector<std::size_t> deps;
+            depend_on(deps, imaging);
+            depend_on(deps, arm);
+            const std::size_t id =
+                add(Kind::Scan, step.mode, 0.0, i, std::move(deps));
+            imaging = acquisition = id;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+std::size_t ScanPipeline::add(Kind kind, Mode mode, double arg,
+                              std::size_t step,
+                              std::vector<std::size_t> deps) {
+    Task task{kind, mode, arg, step, std::move(deps)};
+    tasks_.push_back(std::move(task));
+    return tasks_.size() - 1;
+}
+
+std::vector<std::size_t> ScanPipeline::ready() const {
+    std::vector<std::size_t> out;
+    if (failed_) {
+        return out;
+    }
+    for (std::size_t id = 0; id < tasks_.size(); ++id) {
+        const Task &task = tasks_[id];
+        if (task.state != State::Waiting) {
+            continue;
+        }
+        const bool deps_done =
+            std::all_of(task.deps.begin(), task.deps.end(), [&](auto dep) {
+                return tasks_[dep].state == State::Done;
+            });
+        if (deps_done) {
+            out.push_back(id);
+        }
+    }
+    return out;
+}
+
+std::optional<std::size_t> ScanPipeline::running(Kind kind) const {
+    for (std::size_t id = 0; id < tasks_.size(); ++id) {
+        if (tasks_[id].kind == kind && tasks_[id].state == State::Running) {
+            return id;
+        }
+    }
+    return std::nullopt;
+}
+
+void ScanPipeline::start(std::size_t id, std::int64_t now_ns) {
+    tasks_[id].state = State::Running;
+    tasks_[id].start_ns = now_ns;
+}
+
+void ScanPipeline::finish(std::size_t id, std::int64_t now_ns) {
+    if (tasks_[id].state != State::Running) {
+        return;
+    }
+    tasks_[id].state = State::Done;
+    tasks_[id].end_ns = now_ns;
+    ++finished_;
+}
+
+void ScanPipeline::fail(std::size_t id, std::int64_t now_ns) {
+    tasks_[id].state = State::Failed;
+    tasks_[id].end_ns = now_ns;
+    failed_ = true;
+}
+
+ScanPipeline::Report ScanPipeline::report() const {
+    Report report;
+    std::int64_t first = 0;
+    std::int64_t last = 0;
+    bool any = false;
+    for (const Task &task : tasks_) {
+        if (task.state != State::Done && task.state != State::Failed) {
+            continue;
+        }
+        report.serial_ns += task.end_ns - task.start_ns;
+        first = any ? std::min(first, task.start_ns) : task.start_ns;
+        last = any ? std::max(last, task.end_ns) : task.end_ns;
+        any = true;
+    }
+    report.wall_ns = last - first;
+    return report;
+}
+
+const char *to_string(ScanPipeline::Kind kind) {
+    switch (kind) {
+    case ScanPipeline::Kind::Configure:
+        return "Configure";
+    case ScanPipeline::Kind::Focus:
+        return "Focus";
+    case ScanPipeline::Kind::PlanMove:
+        return "PlanMove";
+    case ScanPipeline::Kind::Move:
+        return "Move";
+    case ScanPipeline::Kind::Scan:
+        return "Scan";
+    }
+    return "?";
+}
+
+const char *to_string(Mode mode) {
+    switch (mode) {
+    case Mode::ROBOT:
+        return "ROBOT";
+    case Mode::OCT:
+        return "OCT";
+    case Mode::OCTA:
+        return "OCTA";
+    case Mode::OCE:
+        return "OCE";
+    }
+    return "?";
+}
@@ -0,0 +1,117 @@
+#ifndef SCAN_PIPELINE_HPP
+#define SCAN_PIPELINE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+enum class UserAction {
+    None,
+    Freedrive,
+    Reset,
+    MoveZangle,
+    Focus,
+    Scan,
+};
+
+enum class Mode {
+    ROBOT,
+    OCT,
+    OCTA,
+    OCE,
+};
+
+// One step of a full-scan recipe. `arg` is the yaw increment in degrees for
+// MoveZangle steps.
+struct Step {
+    UserAction action;
+    Mode mode;
+    double arg;
+};
+
+// A full-scan recipe turned into a dependency graph of tasks, so work that
+// uses different hardware can overlap. The arm and the imaging side (LabVIEW
+// and the OCT engine) are tracked separately:
+//
+//  - a mode change (Configure) waits only for the previous acquisition, so
+//    LabVIEW reconfigures while the arm is still rotating;
+//  - the next move is planned (PlanMove) as soon as the arm is at rest, i.e.
+//    while the scans at the current position run;
+//  - a Move waits for its plan and for the previous acquisition, and a Scan
+//    for the mode it needs and for the arm to be at rest.
+//
+// The mode of a MoveZangle step is the mode the following scans want, so it
+// is configured during the move. Without pipelining every task depends on
+// the one before it and moves plan inline, which is how the coordinator used
+// to walk the recipe.
+//
+// The class only keeps the bookkeeping; the coordinator starts the tasks
+// and reports when they finish.
+class ScanPipeline {
+  public:
+    enum class Kind { Configure, Focus, PlanMove, Move, Scan };
+    enum class State { Waiting, Running, Done, Failed };
+
+    struct Task {
+        Kind kind;
+        // Configure, Focus and Scan: the imaging mode.
+        Mode mode;
+        // Move and PlanMove: yaw increment in degrees.
+        double arg;
+        // Index of the recipe step the task came from.
+        std::size_t step;
+        std::vector<std::size_t> deps;
+        State state = State::Waiting;
+        std::int64_t start_ns = 0;
+        std::int64_t end_ns = 0;
+    };
+
+    struct Report {
+        // First start to last finish.
+        std::int64_t wall_ns = 0;
+        // Sum of all task durations: the run time if nothing had overlapped.
+        std::int64_t serial_ns = 0;
+    };
+
+    ScanPipeline(std::span<const Step> recipe, bool pipelined);
+
+    bool pipelined() const { return pipelined_; }
+    std::size_t size() const { return tasks_.size(); }
+    std::size_t steps() const { return steps_; }
+    const Task &task(std::size_t id) const { return tasks_[id]; }
+
+    // Waiting tasks whose dependencies are all done, in recipe order.
+    std::vector<std::size_t> ready() const;
+    // The running task of `kind`, if any. At most one task of each kind runs
+    // at a time.
+    std::optional<std::size_t> running(Kind kind) const;
+
+    void start(std::size_t id, std::int64_t now_ns);
+    void finish(std::size_t id, std::int64_t now_ns);
+    // Nothing is started after a failure.
+    void fail(std::size_t id, std::int64_t now_ns);
+    // Stops starting tasks without blaming one, e.g. on cancel.
+    void abort() { failed_ = true; }
+
+    bool done() const { return finished_ == tasks_.size(); }
+    bool failed() const { return failed_; }
+
+    Report report() const;
+
+  private:
+    std::size_t add(Kind kind, Mode mode, double arg, std::size_t step,
+                    std::vector<std::size_t> deps);
+
+    bool pipelined_;
+    std::size_t steps_;
+    std::vector<Task> tasks_;
+    std::size_t finished_ = 0;
+    bool failed_ = false;
+};
+
+const char *to_string(ScanPipeline::Kind kind);
+const char *to_string(Mode mode);
+
+#endif // SCAN_PIPELINE_HPP
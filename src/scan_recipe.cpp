@@ -0,0 +1,307 @@
+#include "scan_recipe.hpp"
+
+#include <array>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <sstream>
+
+#include <yaml-cpp/yaml.h>
+
+namespace {
+
+// A typo such as `repeat: 1e6` should fail to load, not fill memory.
+constexpr std::size_t kMaxSteps = 1000;
+constexpr int kMaxDepth = 8;
+
+[[noreturn]] void fail(const std::string &where, const std::string &what) {
+    throw RecipeError(where.empty() ? what : where + ": " + what);
+}
+
+double number(const YAML::Node &node, const std::string &where) {
+    if (!node.IsScalar()) {
+        fail(where, "expected a number");
+    }
+    try {
+        return node.as<double>();
+    } catch (const YAML::Exception &) {
+        fail(where, std::format("expected a number, got '{}'", node.Scalar()));
+    }
+}
+
+double number_or(const YAML::Node &node, const std::string &where,
+                 double fallback) {
+    return node ? number(node, where) : fallback;
+}
+
+Mode mode(const YAML::Node &node, const std::string &where) {
+    if (!node.IsScalar()) {
+        fail(where, "expected a mode");
+    }
+    const auto mode = mode_from_string(node.Scalar());
+    if (!mode) {
+        fail(where, std::format("unknown mode '{}'", node.Scalar()));
+    }
+    return *mode;
+}
+
+std::size_t index(Mode mode) { return static_cast<std::size_t>(mode); }
+
+struct Limits {
+    double max_step_deg = 30.0;
+    double max_yaw_deg = 180.0;
+};
+
+struct Durations {
+    double focus = 0.0;
+    double configure = 0.0;
+    double move_per_deg = 0.0;
+    std::array<double, 4> scan{};
+};
+
+// Unrolls the step list into `steps`. Moves without a mode are marked in
+// `open_mode` and resolved once the whole list is known.
+class Flattener {
+  public:
+    explicit Flattener(const Limits &limits) : limits_(limits) {}
+
+    void run(const YAML::Node &list, const std::string &where, int depth) {
+        if (!list.IsSequence()) {
+            fail(where, "expected a list of steps");
+        }
+        if (depth > kMaxDepth) {
+            fail(where, "repeats nested too deeply");
+        }
+        for (std::size_t i = 0; i < list.size(); ++i) {
+            step(list[i], std::format("{}[{}]", where, i), depth);
+        }
+    }
+
+    std::vector<Step> steps;
+    std::vector<bool> open_mode;
+
+  private:
+    void step(const YAML::Node &item, const std::string &at, int depth) {
+        if (!item.IsMap()) {
+            fail(at, "expected a step such as {scan: OCE}");
+        }
+        std::string action;
+        for (const auto &entry : item) {
+            const std::string key = entry.first.as<std::string>();
+            if (key == "focus" || key == "scan" || key == "move" ||
+                key == "repeat") {
+                if (!action.empty()) {
+                    fail(at, std::format("both '{}' and '{}'", action, key));
+                }
+                action = key;
+            } else if (key != "mode" && key != "steps") {
+                fail(at, std::format("unknown key '{}'", key));
+            }
+        }
+        if (action.empty()) {
+            fail(at, "expected one of focus, scan, move or repeat");
+        }
+        if (item["steps"] && action != "repeat") {
+            fail(at, "only repeat takes steps");
+        }
+        if (item["mode"] && action != "move") {
+            fail(at, "only move takes a separate mode");
+        }
+
+        if (action == "repeat") {
+            const double count = number(item["repeat"], at + ".repeat");
+            if (count < 1 || count != std::floor(count) ||
+                count > static_cast<double>(kMaxSteps)) {
+                fail(at + ".repeat",
+                     std::format("expected a count from 1 to {}", kMaxSteps));
+            }
+            if (!item["steps"]) {
+                fail(at, "repeat without steps");
+            }
+            for (int n = 0; n < static_cast<int>(count); ++n) {
+                run(item["steps"], at + ".steps", depth + 1);
+            }
+            return;
+        }
+
+        if (steps.size() == kMaxSteps) {
+            fail(at, std::format("more than {} steps", kMaxSteps));
+        }
+        const YAML::Node value = item[action];
+        const std::string where = at + "." + action;
+        if (action == "focus") {
+            const Mode focus_mode =
+                value.IsNull() ? Mode::ROBOT : mode(value, where);
+            add({UserAction::Focus, focus_mode, 0.0}, false);
+        } else if (action == "scan") {
+            const Mode scan_mode = mode(value, where);
+            if (scan_mode == Mode::ROBOT) {
+                fail(where, "ROBOT mode does not acquire anything");
+            }
+            add({UserAction::Scan, scan_mode, 0.0}, false);
+        } else {
+            const double deg = number(value, where);
+            if (deg == 0.0 || std::abs(deg) > limits_.max_step_deg) {
+                fail(where, std::format("{} deg is outside 0 < |deg| <= {}",
+                                        deg, limits_.max_step_deg));
+            }
+            const YAML::Node move_mode = item["mode"];
+            add({UserAction::MoveZangle,
+                 move_mode ? mode(move_mode, at + ".mode") : Mode::ROBOT, deg},
+                !move_mode);
+        }
+    }
+
+    void add(Step step, bool open) {
+        steps.push_back(step);
+        open_mode.push_back(open);
+    }
+
+    const Limits &limits_;
+};
+
+} // namespace
+
+ScanPlan compile_scan_plan(const std::string &yaml, std::string path) {
+    YAML::Node root;
+    try {
+        root = YAML::Load(yaml);
+    } catch (const YAML::Exception &e) {
+        fail(path, e.what());
+    }
+    if (!root.IsMap()) {
+        fail(path, "expected a map with name, limits, durations and steps");
+    }
+
+    ScanPlan plan;
+    plan.path = std::move(path);
+
+    try {
+        if (root["name"]) {
+            plan.name = root["name"].as<std::string>();
+        } else if (!plan.path.empty()) {
+            const std::size_t slash = plan.path.find_last_of('/');
+            plan.name = plan.path.substr(slash + 1);
+            plan.name = plan.name.substr(0, plan.name.find('.'));
+        } else {
+            plan.name = "recipe";
+        }
+
+        Limits limits;
+        if (const YAML::Node node = root["limits"]) {
+            limits.max_step_deg = number_or(node["max_step_deg"],
+                                            "limits.max_step_deg",
+                                            limits.max_step_deg);
+            limits.max_yaw_deg = number_or(
+                node["max_yaw_deg"], "limits.max_yaw_deg", limits.max_yaw_deg);
+        }
+
+        Durations durations;
+        if (const YAML::Node node = root["durations"]) {
+            durations.focus = number_or(node["focus"], "durations.focus", 0.0);
+            durations.configure =
+                number_or(node["configure"], "durations.configure", 0.0);
+            durations.move_per_deg =
+                number_or(node["move_per_deg"], "durations.move_per_deg", 0.0);
+            if (const YAML::Node scan = node["scan"]) {
+                if (!scan.IsMap()) {
+                    fail("durations.scan", "expected a map of mode: seconds");
+                }
+                for (const auto &entry : scan) {
+                    const std::string where =
+                        "durations.scan." + entry.first.as<std::string>();
+                    durations.scan[index(mode(entry.first, where))] =
+                        number(entry.second, where);
+                }
+            }
+        }
+
+        if (!root["steps"]) {
+            fail("", "no steps");
+        }
+        Flattener flat(limits);
+        flat.run(root["steps"], "steps", 0);
+        if (flat.steps.empty()) {
+            fail("steps", "no steps");
+        }
+        plan.steps = std::move(flat.steps);
+
+        // A move configures the mode the scans after it want.
+        Mode next_scan = Mode::ROBOT;
+        for (std::size_t i = plan.steps.size(); i-- > 0;) {
+            Step &step = plan.steps[i];
+            if (step.action == UserAction::Scan) {
+                next_scan = step.mode;
+            } else if (flat.open_mode[i]) {
+                step.mode = next_scan;
+            }
+        }
+
+        // Yaw reached and time taken per step, with the mode switches the
+        // coordinator makes when it runs the steps in order.
+        double yaw = 0.0;
+        std::optional<Mode> configured;
+        for (std::size_t i = 0; i < plan.steps.size(); ++i) {
+            const Step &step = plan.steps[i];
+            double seconds = 0.0;
+            if (configured != step.mode) {
+                seconds += durations.configure;
+                configured = step.mode;
+            }
+            switch (step.action) {
+            case UserAction::Focus:
+                seconds += durations.focus;
+                break;
+            case UserAction::MoveZangle:
+                yaw += step.arg;
+                if (std::abs(yaw) > limits.max_yaw_deg) {
+                    fail(std::format("step {}", i + 1),
+                         std::format("yaw {:+} deg is beyond the {} deg limit",
+                                     yaw, limits.max_yaw_deg));
+                }
+                seconds += std::abs(step.arg) * durations.move_per_deg;
+                break;
+            case UserAction::Scan:
+                seconds += durations.scan[index(step.mode)];
+                break;
+            default:
+                break;
+            }
+            plan.yaw_deg.push_back(yaw);
+            plan.expected_s.push_back(seconds);
+            plan.expected_total_s += seconds;
+        }
+    } catch (const YAML::Exception &e) {
+        fail(plan.path, e.what());
+    }
+    return plan;
+}
+
+ScanPlan load_scan_plan(const std::string &path) {
+    std::ifstream file(path);
+    if (!file) {
+        fail(path, "cannot read file");
+    }
+    std::stringstream yaml;
+    yaml << file.rdbuf();
+    return compile_scan_plan(yaml.str(), path);
+}
+
+std::string recipe_path(const std::string &recipe,
+                        const std::string &share_dir) {
+    const bool is_path = recipe.find('/') != std::string::npos ||
+                         recipe.ends_with(".yaml") || recipe.ends_with(".yml");
+    if (is_path) {
+        return recipe;
+    }
+    return share_dir + "/config/recipes/" + recipe + ".yaml";
+}
+
+std::optional<Mode> mode_from_string(std::string_view name) {
+    for (Mode mode : {Mode::ROBOT, Mode::OCT, Mode::OCTA, Mode::OCE}) {
+        if (name == to_string(mode)) {
+            return mode;
+        }
+    }
+    return std::nullopt;
+}
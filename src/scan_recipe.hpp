@@ -0,0 +1,49 @@
+#ifndef SCAN_RECIPE_HPP
+#define SCAN_RECIPE_HPP
+
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "scan_pipeline.hpp"
+
+// A full-scan recipe read from YAML (see config/recipes/default.yaml) and
+// compiled into the flat list of steps the coordinator runs. Repeats are
+// unrolled, move modes are resolved and the whole plan is checked against
+// the recipe's limits when it is loaded, so a bad recipe is rejected before
+// the arm moves rather than halfway through a run.
+struct ScanPlan {
+    std::string name;
+    // File the plan was loaded from.
+    std::string path;
+    std::vector<Step> steps;
+    // Per step: the arm's yaw relative to the start of the scan once the
+    // step has run, in degrees.
+    std::vector<double> yaw_deg;
+    // Per step: expected duration in seconds, including switching LabVIEW
+    // to the step's mode.
+    std::vector<double> expected_s;
+    // Time to run the steps one after the other.
+    double expected_total_s = 0.0;
+};
+
+class RecipeError : public std::runtime_error {
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+// Both throw RecipeError naming the offending step, e.g.
+// "steps[3].steps[0]: unknown mode 'OCX'".
+ScanPlan compile_scan_plan(const std::string &yaml, std::string path = "");
+ScanPlan load_scan_plan(const std::string &path);
+
+// A bare name such as "default" is looked up as config/recipes/<name>.yaml
+// under `share_dir`; anything with a slash or a .yaml suffix is a path.
+std::string recipe_path(const std::string &recipe,
+                        const std::string &share_dir);
+
+std::optional<Mode> mode_from_string(std::string_view name);
+
+#endif // SCAN_RECIPE_HPP
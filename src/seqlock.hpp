@@ -0,0 +1,72 @@
+#ifndef SEQLOCK_HPP
+#define SEQLOCK_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// A value of a small trivially copyable type shared by one writer and any
+// number of readers without a lock. The writer never waits; a reader copies
+// the value and retries if a store overlapped the copy, so readers only spin
+// while a store is in progress.
+//
+// The value is kept as relaxed atomic words rather than plain memory so the
+// overlapping copy is not a data race.
+template <class T> class Seqlock {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Seqlock holds trivially copyable values only");
+
+  public:
+    Seqlock() { store(T{}); }
+    explicit Seqlock(const T &value) { store(value); }
+
+    Seqlock(const Seqlock &) = delete;
+    Seqlock &operator=(const Seqlock &) = delete;
+
+    // Single writer only.
+    void store(const T &value) {
+        std::array<std::uint64_t, kWords> words{};
+        std::memcpy(words.data(), &value, sizeof(T));
+        const std::uint64_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < kWords; ++i) {
+            words_[i].store(words[i], std::memory_order_relaxed);
+        }
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    T load() const {
+        std::array<std::uint64_t, kWords> words;
+        std::uint64_t before;
+        std::uint64_t after;
+        do {
+            before = seq_.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < kWords; ++i) {
+                words[i] = words_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = seq_.load(std::memory_order_relaxed);
+        } while ((before & 1) != 0 || before != after);
+        T value;
+        std::memcpy(&value, words.data(), sizeof(T));
+        return value;
+    }
+
+    // Number of completed stores, including the initial one.
+    std::uint64_t version() const {
+        return seq_.load(std::memory_order_acquire) / 2;
+    }
+
+  private:
+    static constexpr std::size_t kWords =
+        (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+    std::atomic<std::uint64_t> seq_{0};
+    std::array<std::atomic<std::uint64_t>, kWords> words_{};
+};
+
+#endif // SEQLOCK_HPP
@@ -0,0 +1,114 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define OCTA_SIMD_AVX2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define OCTA_SIMD_NEON 1
+#endif
+
+// Minimal float vector wrapper for the image kernels. The scalar fallback
+// uses a single lane so kernels are written once as `x += simd::kLanes` loops
+// followed by a scalar tail.
+namespace simd {
+
+#if defined(OCTA_SIMD_AVX2)
+
+constexpr int kLanes = 8;
+using vf = __m256;
+
+inline vf load(const float *p) { return _mm256_loadu_ps(p); }
+inline void store(float *p, vf v) { _mm256_storeu_ps(p, v); }
+inline vf set1(float v) { return _mm256_set1_ps(v); }
+inline vf add(vf a, vf b) { return _mm256_add_ps(a, b); }
+inline vf sub(vf a, vf b) { return _mm256_sub_ps(a, b); }
+inline vf mul(vf a, vf b) { return _mm256_mul_ps(a, b); }
+inline vf min(vf a, vf b) { return _mm256_min_ps(a, b); }
+inline vf max(vf a, vf b) { return _mm256_max_ps(a, b); }
+inline vf sqrt(vf a) { return _mm256_sqrt_ps(a); }
+#if defined(__FMA__)
+inline vf fmadd(vf a, vf b, vf c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+inline vf fmadd(vf a, vf b, vf c) {
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+}
+#endif
+
+inline vf load_u8(const std::uint8_t *p) {
+    __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p));
+    return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+}
+
+inline float reduce_min(vf v) {
+    __m128 m =
+        _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_min_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+
+inline float reduce_max(vf v) {
+    __m128 m =
+        _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+
+#elif defined(OCTA_SIMD_NEON)
+
+constexpr int kLanes = 4;
+using vf = float32x4_t;
+
+inline vf load(const float *p) { return vld1q_f32(p); }
+inline void store(float *p, vf v) { vst1q_f32(p, v); }
+inline vf set1(float v) { return vdupq_n_f32(v); }
+inline vf add(vf a, vf b) { return vaddq_f32(a, b); }
+inline vf sub(vf a, vf b) { return vsubq_f32(a, b); }
+inline vf mul(vf a, vf b) { return vmulq_f32(a, b); }
+inline vf min(vf a, vf b) { return vminq_f32(a, b); }
+inline vf max(vf a, vf b) { return vmaxq_f32(a, b); }
+inline vf sqrt(vf a) { return vsqrtq_f32(a); }
+inline vf fmadd(vf a, vf b, vf c) { return vfmaq_f32(c, a, b); }
+
+inline vf load_u8(const std::uint8_t *p) {
+    std::uint32_t word;
+    std::memcpy(&word, p, sizeof(word));
+    uint16x8_t wide = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(word)));
+    return vcvtq_f32_u32(vmovl_u16(vget_low_u16(wide)));
+}
+
+inline float reduce_min(vf v) { return vminvq_f32(v); }
+inline float reduce_max(vf v) { return vmaxvq_f32(v); }
+
+#else
+
+constexpr int kLanes = 1;
+using vf = float;
+
+inline vf load(const float *p) { return *p; }
+inline void store(float *p, vf v) { *p = v; }
+inline vf set1(float v) { return v; }
+inline vf add(vf a, vf b) { return a + b; }
+inline vf sub(vf a, vf b) { return a - b; }
+inline vf mul(vf a, vf b) { return a * b; }
+inline vf min(vf a, vf b) { return std::min(a, b); }
+inline vf max(vf a, vf b) { return std::max(a, b); }
+inline vf sqrt(vf a) { return std::sqrt(a); }
+inline vf fmadd(vf a, vf b, vf c) { return a * b + c; }
+inline vf load_u8(const std::uint8_t *p) { return static_cast<float>(*p); }
+inline float reduce_min(vf v) { return v; }
+inline float reduce_max(vf v) { return v; }
+
+#endif
+
+} // namespace simd
+
+#endif // SIMD_HPP
@@ -0,0 +1,216 @@
+#include "sliding_median.hpp"
+
+#include <algorithm>
+#include <utility>
+
+SlidingMedian::SlidingMedian(int window) { reset(window); }
+
+void SlidingMedian::reset(int window) {
+    window_ = std::max(1, window);
+    values_.resize(window_);
+    pos_.resize(window_);
+    lo_.resize(window_);
+    hi_.resize(window_);
+    clear();
+}
+
+void SlidingMedian::clear() {
+    count_ = 0;
+    head_ = 0;
+    lo_size_ = 0;
+    hi_size_ = 0;
+}
+
+double SlidingMedian::push(double value) {
+    if (count_ < window_) {
+        int slot = count_++;
+        values_[slot] = value;
+        if (hi_size_ == 0 || value >= values_[hi_[0]]) {
+            hi_push(slot);
+        } else {
+            lo_push(slot);
+        }
+        while (lo_size_ > count_ / 2) {
+            hi_push(lo_pop());
+        }
+        while (hi_size_ > count_ - count_ / 2) {
+            lo_push(hi_pop());
+        }
+        return median();
+    }
+
+    // Window is full: overwrite the oldest slot and restore heap order.
+    int slot = head_;
+    head_ = (head_ + 1 == window_) ? 0 : head_ + 1;
+    double old = values_[slot];
+    values_[slot] = value;
+    int p = pos_[slot];
+    if (p >= 0) {
+        if (value < old) {
+            hi_sift_up(p);
+        } else {
+            hi_sift_down(p);
+        }
+    } else {
+        int i = -p - 1;
+        if (value > old) {
+            lo_sift_up(i);
+        } else {
+            lo_sift_down(i);
+        }
+    }
+    if (lo_size_ > 0 && less(hi_[0], lo_[0])) {
+        exchange_tops();
+    }
+    return median();
+}
+
+double SlidingMedian::median() const {
+    return count_ == 0 ? 0.0 : values_[hi_[0]];
+}
+
+void SlidingMedian::lo_swap(int i, int j) {
+    std::swap(lo_[i], lo_[j]);
+    pos_[lo_[i]] = -i - 1;
+    pos_[lo_[j]] = -j - 1;
+}
+
+void SlidingMedian::hi_swap(int i, int j) {
+    std::swap(hi_[i], hi_[j]);
+    pos_[hi_[i]] = i;
+    pos_[hi_[j]] = j;
+}
+
+void SlidingMedian::lo_sift_up(int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!less(lo_[parent], lo_[i])) {
+            break;
+        }
+        lo_swap(i, parent);
+        i = parent;
+    }
+}
+
+void SlidingMedian::lo_sift_down(int i) {
+    while (true) {
+        int largest = i;
+        int l = 2 * i + 1;
+        int r = l + 1;
+        if (l < lo_size_ && less(lo_[largest], lo_[l])) {
+            largest = l;
+        }
+        if (r < lo_size_ && less(lo_[largest], lo_[r])) {
+            largest = r;
+        }
+        if (largest == i) {
+            break;
+        }
+        lo_swap(i, largest);
+        i = largest;
+    }
+}
+
+void SlidingMedian::hi_sift_up(int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!less(hi_[i], hi_[parent])) {
+            break;
+        }
+        hi_swap(i, parent);
+        i = parent;
+    }
+}
+
+void SlidingMedian::hi_sift_down(int i) {
+    while (true) {
+        int smallest = i;
+        int l = 2 * i + 1;
+        int r = l + 1;
+        if (l < hi_size_ && less(hi_[l], hi_[smallest])) {
+            smallest = l;
+        }
+        if (r < hi_size_ && less(hi_[r], hi_[smallest])) {
+            smallest = r;
+        }
+        if (smallest == i) {
+            break;
+        }
+        hi_swap(i, smallest);
+        i = smallest;
+    }
+}
+
+void SlidingMedian::lo_push(int slot) {
+    int i = lo_size_++;
+    lo_[i] = slot;
+    pos_[slot] = -i - 1;
+    lo_sift_up(i);
+}
+
+void SlidingMedian::hi_push(int slot) {
+    int i = hi_size_++;
+    hi_[i] = slot;
+    pos_[slot] = i;
+    hi_sift_up(i);
+}
+
+int SlidingMedian::lo_pop() {
+    int top = lo_[0];
+    if (--lo_size_ > 0) {
+        lo_[0] = lo_[lo_size_];
+        pos_[lo_[0]] = -1;
+        lo_sift_down(0);
+    }
+    return top;
+}
+
+int SlidingMedian::hi_pop() {
+    int top = hi_[0];
+    if (--hi_size_ > 0) {
+        hi_[0] = hi_[hi_size_];
+        pos_[hi_[0]] = 0;
+        hi_sift_down(0);
+    }
+    return top;
+}
+
+void SlidingMedian::exchange_tops() {
+    int lo_top = lo_[0];
+    int hi_top = hi_[0];
+    lo_[0] = hi_top;
+    pos_[hi_top] = -1;
+    hi_[0] = lo_top;
+    pos_[lo_top] = 0;
+    lo_sift_down(0);
+    hi_sift_down(0);
+}
+
+void median_filter_1d(std::vector<double> &signal, int window_size,
+                      SlidingMedian &filter) {
+    const int n = static_cast<int>(signal.size());
+    if (n == 0 || window_size <= 1) {
+        return;
+    }
+    filter.reset(window_size);
+
+    // Sample k of the edge-replicated signal; indices read are always at or
+    // ahead of the output index, so filtering in place is safe.
+    const int half_win = window_size / 2;
+    const double front = signal.front();
+    const double back = signal.back();
+    auto extended = [&](int k) {
+        k -= half_win;
+        if (k < 0) {
+            return front;
+        }
+        return k < n ? signal[k] : back;
+    };
+
+    for (int k = 0; k < window_size - 1; ++k) {
+        filter.push(extended(k));
+    }
+    for (int i = 0; i < n; ++i) {
+        signal[i] = filter.push(extended(i + window_size - 1));
+    }
+}
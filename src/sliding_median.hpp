@@ -0,0 +1,60 @@
+#ifndef SLIDING_MEDIAN_HPP
+#define SLIDING_MEDIAN_HPP
+
+#include <cstddef>
+#include <vector>
+
+// Running median over the last `window` samples in O(log window) per sample.
+// Samples live in a ring; a max-heap holds the lower half and a min-heap the
+// upper half, both storing ring slots so the sample that drops out of the
+// window can be replaced in place. Storage is sized by reset() and reused, so
+// streaming through a signal does not allocate.
+//
+// median() returns the element at index window / 2 of the sorted window (the
+// upper median for even windows), matching nth_element at size / 2.
+class SlidingMedian {
+  public:
+    explicit SlidingMedian(int window = 1);
+
+    void reset(int window);
+    void clear();
+
+    double push(double value);
+    double median() const;
+
+    int window() const { return window_; }
+    int size() const { return count_; }
+
+  private:
+    bool less(int a, int b) const { return values_[a] < values_[b]; }
+
+    void lo_swap(int i, int j);
+    void hi_swap(int i, int j);
+    void lo_sift_up(int i);
+    void lo_sift_down(int i);
+    void hi_sift_up(int i);
+    void hi_sift_down(int i);
+    void lo_push(int slot);
+    void hi_push(int slot);
+    int lo_pop();
+    int hi_pop();
+    void exchange_tops();
+
+    int window_ = 0;
+    int count_ = 0;
+    int head_ = 0;
+    std::vector<double> values_;
+    // >= 0: index in hi_, < 0: -(index in lo_) - 1
+    std::vector<int> pos_;
+    std::vector<int> lo_;
+    std::vector<int> hi_;
+    int lo_size_ = 0;
+    int hi_size_ = 0;
+};
+
+// Edge-replicated median filter of `signal` in place; `filter` is reused as
+// scratch so repeated calls do not allocate.
+void median_filter_1d(std::vector<double> &signal, int window_size,
+                      SlidingMedian &filter);
+
+#endif // SLIDING_MEDIAN_HPP
@@ -0,0 +1,241 @@
+#include "spatial_filter.hpp"
+#include "simd.hpp"
+
+#include <array>
+#include <cfloat>
+#include <limits>
+
+namespace {
+
+constexpr int kLpCols = 11;
+constexpr int kLpRows = 5;
+constexpr int kGradLpRows = 3;
+constexpr float kGradYWeight = 0.65f;
+
+// 1D factor of build_gaussian_filter(); the 2D kernel is the outer product of
+// the row and column factors, so normalising each factor separately gives the
+// same kernel.
+template <int N> std::array<float, N> gaussian_1d() {
+    std::array<float, N> k{};
+    float c = (N - 1) / 2.0f;
+    float sigma = N / 4.0f;
+    double sum = 0.0;
+    for (int i = 0; i < N; ++i) {
+        float d = static_cast<float>(i) - c;
+        k[i] = std::exp(-(d * d) / (sigma * sigma));
+        sum += k[i];
+    }
+    for (float &v : k) {
+        v = static_cast<float>(v / sum);
+    }
+    return k;
+}
+
+inline int clamp_row(int r, int rows) { return std::clamp(r, 0, rows - 1); }
+
+struct Kernels {
+    std::array<float, kLpCols> lp_x = gaussian_1d<kLpCols>();
+    std::array<float, kLpRows> lp_y = gaussian_1d<kLpRows>();
+    std::array<float, kGradLpRows> grad_y = gaussian_1d<kGradLpRows>();
+};
+
+const Kernels &kernels() {
+    static const Kernels k;
+    return k;
+}
+
+} // namespace
+
+void spatial_filter_response(const std::uint8_t *src, std::size_t src_step,
+                             int rows, int cols, float *dst,
+                             std::size_t dst_step, std::vector<float> &scratch,
+                             float &lo, float &hi) {
+    constexpr int half_x = kLpCols / 2;
+    constexpr int half_y = kLpRows / 2;
+    constexpr int ring = 4;
+    const Kernels &k = kernels();
+
+    // Layout: one padded row for the vertical pass, then the lowpass ring
+    // (one pixel of replicate padding per side for the x gradient), then the
+    // gradient magnitude ring.
+    const int vpad_len = cols + 2 * half_x;
+    const int lp_len = cols + 2;
+    std::size_t needed = static_cast<std::size_t>(vpad_len) +
+                         static_cast<std::size_t>(ring) * (lp_len + cols);
+    if (scratch.size() < needed) {
+        scratch.resize(needed);
+    }
+    float *vrow = scratch.data();
+    float *lp_ring = vrow + vpad_len;
+    float *mag_ring = lp_ring + ring * lp_len;
+
+    auto src_row = [&](int r) {
+        return src + static_cast<std::size_t>(clamp_row(r, rows)) * src_step;
+    };
+    auto lp_row = [&](int r) {
+        return lp_ring + (clamp_row(r, rows) & (ring - 1)) * lp_len + 1;
+    };
+    auto mag_row = [&](int r) {
+        return mag_ring + (clamp_row(r, rows) & (ring - 1)) * cols;
+    };
+
+    auto compute_lp = [&](int r) {
+        const std::uint8_t *s[kLpRows];
+        for (int j = 0; j < kLpRows; ++j) {
+            s[j] = src_row(r + j - half_y);
+        }
+        // Both Gaussians are symmetric, so mirrored taps share a multiply.
+        float *v = vrow + half_x;
+        int x = 0;
+        for (; x + simd::kLanes <= cols; x += simd::kLanes) {
+            simd::vf acc = simd::mul(simd::set1(k.lp_y[half_y]),
+                                     simd::load_u8(s[half_y] + x));
+            for (int j = 0; j < half_y; ++j) {
+                simd::vf pair =
+                    simd::add(simd::load_u8(s[j] + x),
+                              simd::load_u8(s[kLpRows - 1 - j] + x));
+                acc = simd::fmadd(simd::set1(k.lp_y[j]), pair, acc);
+            }
+            simd::store(v + x, acc);
+        }
+        for (; x < cols; ++x) {
+            float acc = k.lp_y[half_y] * static_cast<float>(s[half_y][x]);
+            for (int j = 0; j < half_y; ++j) {
+                acc += k.lp_y[j] * (static_cast<float>(s[j][x]) +
+                                    static_cast<float>(s[kLpRows - 1 - j][x]));
+            }
+            v[x] = acc;
+        }
+        for (int i = 1; i <= half_x; ++i) {
+            v[-i] = v[0];
+            v[cols - 1 + i] = v[cols - 1];
+        }
+
+        float *out = lp_row(r);
+        x = 0;
+        for (; x + simd::kLanes <= cols; x += simd::kLanes) {
+            const float *p = vrow + x;
+            simd::vf acc =
+                simd::mul(simd::set1(k.lp_x[half_x]), simd::load(p + half_x));
+            for (int i = 0; i < half_x; ++i) {
+                simd::vf pair = simd::add(simd::load(p + i),
+                                          simd::load(p + kLpCols - 1 - i));
+                acc = simd::fmadd(simd::set1(k.lp_x[i]), pair, acc);
+            }
+            simd::store(out + x, acc);
+        }
+        for (; x < cols; ++x) {
+            const float *p = vrow + x;
+            float acc = k.lp_x[half_x] * p[half_x];
+            for (int i = 0; i < half_x; ++i) {
+                acc += k.lp_x[i] * (p[i] + p[kLpCols - 1 - i]);
+            }
+            out[x] = acc;
+        }
+        out[-1] = out[0];
+        out[cols] = out[cols - 1];
+    };
+
+    auto compute_mag = [&](int r) {
+        const float *up = lp_row(r - 1);
+        const float *mid = lp_row(r);
+        const float *down = lp_row(r + 1);
+        float *out = mag_row(r);
+        const simd::vf half = simd::set1(0.5f);
+        const simd::vf wy = simd::set1(kGradYWeight);
+        int x = 0;
+        for (; x + simd::kLanes <= cols; x += simd::kLanes) {
+            simd::vf gx = simd::mul(half, simd::sub(simd::load(mid + x + 1),
+                                                    simd::load(mid + x - 1)));
+            simd::vf gy = simd::mul(
+                half, simd::sub(simd::load(down + x), simd::load(up + x)));
+            simd::vf m = simd::fmadd(wy, simd::mul(gy, gy), simd::mul(gx, gx));
+            simd::store(out + x, simd::sqrt(m));
+        }
+        for (; x < cols; ++x) {
+            float gx = 0.5f * (mid[x + 1] - mid[x - 1]);
+            float gy = 0.5f * (down[x] - up[x]);
+            out[x] = std::sqrt(gx * gx + kGradYWeight * (gy * gy));
+        }
+    };
+
+    int next_lp = 0;
+    int next_mag = 0;
+    auto ensure_lp = [&](int r) {
+        r = std::min(r, rows - 1);
+        while (next_lp <= r) {
+            compute_lp(next_lp++);
+        }
+    };
+    auto ensure_mag = [&](int r) {
+        r = std::min(r, rows - 1);
+        while (next_mag <= r) {
+            ensure_lp(next_mag + 1);
+            compute_mag(next_mag++);
+        }
+    };
+
+    simd::vf vmin = simd::set1(std::numeric_limits<float>::max());
+    simd::vf vmax = simd::set1(std::numeric_limits<float>::lowest());
+    float smin = std::numeric_limits<float>::max();
+    float smax = std::numeric_limits<float>::lowest();
+    const simd::vf g0 = simd::set1(k.grad_y[0]);
+    const simd::vf g1 = simd::set1(k.grad_y[1]);
+    const simd::vf g2 = simd::set1(k.grad_y[2]);
+
+    for (int y = 0; y < rows; ++y) {
+        ensure_mag(y + 1);
+        const float *lp = lp_row(y);
+        const float *m0 = mag_row(y - 1);
+        const float *m1 = mag_row(y);
+        const float *m2 = mag_row(y + 1);
+        float *out = reinterpret_cast<float *>(
+            reinterpret_cast<std::uint8_t *>(dst) + y * dst_step);
+        int x = 0;
+        for (; x + simd::kLanes <= cols; x += simd::kLanes) {
+            simd::vf g = simd::mul(g0, simd::load(m0 + x));
+            g = simd::fmadd(g1, simd::load(m1 + x), g);
+            g = simd::fmadd(g2, simd::load(m2 + x), g);
+            simd::vf v = simd::mul(simd::load(lp + x), g);
+            vmin = simd::min(vmin, v);
+            vmax = simd::max(vmax, v);
+            simd::store(out + x, v);
+        }
+        for (; x < cols; ++x) {
+            float g = k.grad_y[0] * m0[x] + k.grad_y[1] * m1[x] +
+                      k.grad_y[2] * m2[x];
+            float v = lp[x] * g;
+            smin = std::min(smin, v);
+            smax = std::max(smax, v);
+            out[x] = v;
+        }
+    }
+    lo = std::min(smin, simd::reduce_min(vmin));
+    hi = std::max(smax, simd::reduce_max(vmax));
+}
+
+void normalize_u8(const cv::Mat &src, cv::Mat &dst, NormRange range) {
+    const double span = range.hi - range.lo;
+    const double scale = 255.0 * (span > DBL_EPSILON ? 1.0 / span : 0.0);
+    const double shift = -range.lo * scale;
+    src.convertTo(dst, CV_8U, scale, shift);
+}
+
+NormRange spatial_filter_fused(const cv::Mat &input, cv::Mat &output,
+                               SpatialFilterWorkspace &ws,
+                               const NormRange *range) {
+    CV_Assert(!input.empty() && input.type() == CV_8UC1);
+
+    ws.response.create(input.size(), CV_32F);
+    float lo = 0.0f;
+    float hi = 0.0f;
+    spatial_filter_response(input.ptr<std::uint8_t>(), input.step, input.rows,
+                            input.cols, ws.response.ptr<float>(),
+                            ws.response.step, ws.rows, lo, hi);
+
+    const NormRange used =
+        range ? *range : NormRange{static_cast<double>(lo),
+                                   static_cast<double>(hi)};
+    normalize_u8(ws.response, output, used);
+    return used;
+}
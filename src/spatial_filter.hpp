@@ -0,0 +1,45 @@
+#ifndef SPATIAL_FILTER_HPP
+#define SPATIAL_FILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+// Input range that min-max normalisation maps to 0..255.
+struct NormRange {
+    double lo = 0.0;
+    double hi = 0.0;
+};
+
+// src.convertTo(dst, CV_8U) with the scale and shift that
+// cv::normalize(..., 0, 255, NORM_MINMAX, CV_8U) uses for an input spanning
+// `range`. Values outside the range saturate.
+void normalize_u8(const cv::Mat &src, cv::Mat &dst, NormRange range);
+
+// Scratch memory for spatial_filter_fused(). Keep one per thread and reuse it
+// across frames; buffers only grow when the frame width or height grows.
+struct SpatialFilterWorkspace {
+    std::vector<float> rows;
+    cv::Mat response;
+};
+
+// Computes lowpass(11, 5) * lowpass(gradient(lowpass(11, 5)), 1, 3) for an
+// 8-bit image in a single streaming sweep. The separable Gaussians, the
+// central-difference gradient and the product work on a four-row ring so the
+// intermediates stay in L1 instead of round-tripping full-frame temporaries.
+// Returns the min and max of the float response through `lo` and `hi`.
+void spatial_filter_response(const std::uint8_t *src, std::size_t src_step,
+                             int rows, int cols, float *dst,
+                             std::size_t dst_step, std::vector<float> &scratch,
+                             float &lo, float &hi);
+
+// Fused replacement for spatialFilter(): response followed by NORM_MINMAX to
+// CV_8U. `input` must be CV_8UC1. If `range` is given the response is mapped
+// from it instead of from its own min and max. Returns the range used.
+NormRange spatial_filter_fused(const cv::Mat &input, cv::Mat &output,
+                               SpatialFilterWorkspace &ws,
+                               const NormRange *range = nullptr);
+
+#endif // SPATIAL_FILTER_HPP
@@ -0,0 +1,55 @@
+#include "status_log.hpp"
+
+#include <algorithm>
+
+StatusLog::StatusLog(std::size_t capacity)
+    : entries_(std::max<std::size_t>(1, capacity)) {}
+
+std::uint64_t StatusLog::push(std::string_view source, Level level,
+                              std::int32_t code, std::string_view text,
+                              std::int64_t stamp_ns) {
+    while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) {
+        text.remove_suffix(1);
+    }
+    text = text.substr(0, kMaxText);
+
+    if (const Entry *last = newest()) {
+        if (last->level == level && last->code == code &&
+            last->source == source && last->text == text) {
+            return last->seq;
+        }
+    }
+
+    Entry &entry = entries_[head_ % entries_.size()];
+    entry.seq = ++head_;
+    entry.stamp_ns = stamp_ns;
+    entry.source.assign(source);
+    entry.level = level;
+    entry.code = code;
+    entry.text.assign(text);
+    return entry.seq;
+}
+
+const StatusLog::Entry *StatusLog::newest() const {
+    if (head_ == 0) {
+        return nullptr;
+    }
+    return &entries_[(head_ - 1) % entries_.size()];
+}
+
+std::vector<const StatusLog::Entry *>
+StatusLog::since(std::uint64_t ack, std::size_t max) const {
+    std::vector<const Entry *> out;
+    if (ack >= head_) {
+        return out;
+    }
+    const std::uint64_t retained =
+        std::min<std::uint64_t>(head_, entries_.size());
+    const std::uint64_t count =
+        std::min<std::uint64_t>({head_ - ack, retained, max});
+    out.reserve(count);
+    for (std::uint64_t seq = head_ - count + 1; seq <= head_; ++seq) {
+        out.push_back(&entries_[(seq - 1) % entries_.size()]);
+    }
+    return out;
+}
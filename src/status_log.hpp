@@ -0,0 +1,57 @@
+#ifndef STATUS_LOG_HPP
+#define STATUS_LOG_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The coordinator's status messages as a fixed-capacity ring of structured
+// entries. Every entry gets the next sequence number, starting at 1; once
+// the ring is full the oldest entry is overwritten. Not thread safe: the
+// coordinator only touches it from its callback path.
+class StatusLog {
+  public:
+    // Same values as StatusEntry.msg.
+    enum class Level : std::uint8_t { Info = 0, Warn = 1, Error = 2 };
+
+    struct Entry {
+        std::uint64_t seq = 0;
+        std::int64_t stamp_ns = 0;
+        std::string source;
+        Level level = Level::Info;
+        std::int32_t code = 0;
+        std::string text;
+    };
+
+    // Longest text kept; matches the bound in StatusEntry.msg.
+    static constexpr std::size_t kMaxText = 128;
+
+    explicit StatusLog(std::size_t capacity = 64);
+
+    std::size_t capacity() const { return entries_.size(); }
+
+    // Trailing newlines are stripped and the text is cut to kMaxText. An
+    // entry identical to the newest one (apart from its time) is not added
+    // again. Returns the sequence number of the entry that holds the text.
+    std::uint64_t push(std::string_view source, Level level, std::int32_t code,
+                       std::string_view text, std::int64_t stamp_ns);
+
+    // Sequence number of the newest entry, 0 while the log is empty.
+    std::uint64_t head() const { return head_; }
+    // Null while the log is empty.
+    const Entry *newest() const;
+
+    // Entries newer than `ack`, oldest first. At most `max` of them: if more
+    // are unacknowledged, or were already overwritten, the oldest are
+    // skipped, so compare the first seq against ack + 1 to notice.
+    std::vector<const Entry *> since(std::uint64_t ack,
+                                     std::size_t max) const;
+
+  private:
+    std::vector<Entry> entries_;
+    std::uint64_t head_ = 0;
+};
+
+#endif // STATUS_LOG_HPP
@@ -1,61 +1,86 @@
-#include <memory>
-#include "rclcpp/rclcpp.hpp"
+
 #include "octa_ros/msg/img.hpp"
-#include <opencv2/opencv.hpp>
+#include "octa_ros/msg/img_frame.hpp"
+#include "rclcpp/rclcpp.hpp"
 #include <filesystem>
+#include <memory>
+#include <opencv2/opencv.hpp>
 
 #define be RMW_QOS_POLICY_RELIABILITY_BEST_EFFORT
 
-class MinimalSubscriber : public rclcpp::Node
-{
-public:
-  MinimalSubscriber()
-      : Node("img_sub"),
-        best_effort(rclcpp::KeepLast(10))
+class MinimalSubscriber : public rclcpp::Node {
+  public:
+    MinimalSubscriber()
+        : Node("img_sub"), best_effort(rclcpp::KeepLast(10))
 
-  {
-    subscription_ = this->create_subscription<octa_ros::msg::Img>(
-        "oct_image",
-       	best_effort.reliability(be),
-       	[this](const octa_ros::msg::Img::SharedPtr msg)
-        { 
-	RCLCPP_INFO(this->get_logger(), "Subscribing"); 
-	RCLCPP_INFO(this->get_logger(), std::format(
-				"length: {}", msg->img.size()
-				).c_str()); 
-	int width = 500;
-	int height = 512;
-	uint8_t reshape_img[512][500];
-	for (int row = 0; row<height; row++) {
-	for (int col = 0; col<width; col++) {
-	reshape_img[row][col] = msg->img[(col+row*width)];
-	}
-	}
+    {
+        subscription_ = this->create_subscription<octa_ros::msg::Img>(
+            "oct_image", best_effort.reliability(be),
+            [this](const octa_ros::msg::Img::SharedPtr msg) {
+                RCLCPP_INFO(this->get_logger(), "Subscribing");
+                RCLCPP_INFO(
+                    this->get_logger(),
+                    std::format("length: {}", msg->img.size()).c_str());
+                // Legacy frames do not carry their geometry.
+                int width = 500;
+                int height = 512;
+                if (msg->img.size() != static_cast<size_t>(width * height)) {
+                    return;
+                }
+                cv::Mat img(height, width, CV_8UC1, msg->img.data());
+                save(img);
+            });
+        frame_subscription_ =
+            this->create_subscription<octa_ros::msg::ImgFrame>(
+                "oct_frame", best_effort.reliability(be),
+                [this](const octa_ros::msg::ImgFrame::SharedPtr msg) {
+                    RCLCPP_INFO(
+                        this->get_logger(),
+                        std::format("frame {}: {}x{} {} (B-scan {}/{})",
+                                    msg->frame_counter, msg->width,
+                                    msg->height, msg->encoding,
+                                    msg->bscan_index + 1, msg->bscan_count)
+                            .c_str());
+                    int type = msg->bit_depth == 16 ? CV_16UC1 : CV_8UC1;
+                    size_t bytes = static_cast<size_t>(msg->width) *
+                                   msg->height * (msg->bit_depth == 16 ? 2 : 1);
+                    if (msg->data.size() != bytes) {
+                        return;
+                    }
+                    cv::Mat img(static_cast<int>(msg->height),
+                                static_cast<int>(msg->width), type,
+                                msg->data.data());
+                    if (type == CV_16UC1) {
+                        cv::Mat img8;
+                        img.convertTo(img8, CV_8U, 1.0 / 256.0);
+                        save(img8);
+                    } else {
+                        save(img);
+                    }
+                });
+    }
 
-	cv::Mat img(height, width, CV_8UC1, reshape_img);
-	
+  private:
+    void save(const cv::Mat &img) {
         cv::imwrite("test/test.jpg", img);
-	std::string filename = std::format("test/test{}.jpg", count);
-	if (std::filesystem::exists(filename.c_str())) {
-	    count++;
-	    filename = std::format("test/test{}.jpg", count);
-	}
+        std::string filename = std::format("test/test{}.jpg", count);
+        if (std::filesystem::exists(filename.c_str())) {
+            count++;
+            filename = std::format("test/test{}.jpg", count);
+        }
         cv::imwrite(filename.c_str(), img);
+    }
 
-	}
-	);
-  }
-
-private:
-  rclcpp::Subscription<octa_ros::msg::Img>::SharedPtr subscription_;
-  rclcpp::QoS best_effort;
-  int count = 0;
+    rclcpp::Subscription<octa_ros::msg::Img>::SharedPtr subscription_;
+    rclcpp::Subscription<octa_ros::msg::ImgFrame>::SharedPtr
+        frame_subscription_;
+    rclcpp::QoS best_effort;
+    int count = 0;
 };
 
-int main(int argc, char *argv[])
-{
-  rclcpp::init(argc, argv);
-  rclcpp::spin(std::make_shared<MinimalSubscriber>());
-  rclcpp::shutdown();
-  return 0;
+int main(int argc, char *argv[]) {
+    rclcpp::init(argc, argv);
+    rclcpp::spin(std::make_shared<MinimalSubscriber>());
+    rclcpp::shutdown();
+    return 0;
 }
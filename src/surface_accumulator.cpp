@@ -0,0 +1,137 @@
+#include "surface_accumulator.hpp"
+#include "bscan_selector.hpp"
+#include "debug_writer.hpp"
+#include "thread_pool.hpp"
+
+#include <numeric>
+
+SurfaceAccumulator::SurfaceAccumulator(int interval, bool acq_interval,
+                                       DebugWriter *debug)
+    : SurfaceAccumulator(interval, acq_interval, debug, ThreadPool::shared()) {
+}
+
+SurfaceAccumulator::SurfaceAccumulator(int interval, bool acq_interval,
+                                       DebugWriter *debug, ThreadPool &pool)
+    : interval_(interval), acq_interval_(acq_interval), debug_(debug),
+      pool_(pool) {}
+
+void SurfaceAccumulator::set_confidence_thresholds(float column,
+                                                   float frame) {
+    min_column_confidence_ = column;
+    min_frame_confidence_ = frame;
+}
+
+int SurfaceAccumulator::place(const FrameHandle &frame) {
+    // Frames that report their B-scan position are placed (and tracked) by
+    // it; others are assumed evenly spaced in arrival order.
+    const FrameHandle::Info &info = frame.info();
+    int index = static_cast<int>(frames_.size()) % interval_;
+    double z_val = 0.0;
+    if (info.bscan_index >= 0 && info.bscan_count > 1) {
+        index = info.bscan_index;
+        z_val = bscan_position(info.bscan_index, info.bscan_count);
+    } else {
+        int num_frames = interval_ > 1 ? interval_ : 2;
+        z_val = index * 499.0 / static_cast<double>(num_frames - 1);
+    }
+    frames_.push_back(frame);
+    z_.push_back(z_val);
+    return index;
+}
+
+void SurfaceAccumulator::submit(const FrameHandle &frame) {
+    const int index = place(frame);
+    if (tracker_) {
+        pending_.push_back(pool_.submit([frame, index, tracker = tracker_]() {
+            return detect_lines_tracked(frame.mat(), *tracker, index);
+        }));
+    } else {
+        pending_.push_back(
+            pool_.submit([frame]() { return detect_lines(frame.mat()); }));
+    }
+}
+
+void SurfaceAccumulator::submit_batch(std::span<const FrameHandle> frames) {
+    std::vector<cv::Mat> mats;
+    std::vector<int> indices;
+    mats.reserve(frames.size());
+    indices.reserve(frames.size());
+    for (const FrameHandle &frame : frames) {
+        indices.push_back(place(frame));
+        mats.push_back(frame.mat());
+    }
+    std::vector<SegmentResult> results =
+        detect_lines_batch(mats, tracker_, indices);
+    for (SegmentResult &result : results) {
+        std::promise<SegmentResult> ready;
+        pending_.push_back(ready.get_future());
+        ready.set_value(std::move(result));
+    }
+}
+
+void SurfaceAccumulator::collect() {
+    for (; collected_ < pending_.size(); ++collected_) {
+        size_t i = collected_;
+        SegmentResult pc = pending_[i].get();
+        if (complete_) {
+            continue;
+        }
+        bool failed = pc.coordinates.empty();
+        if (!failed && min_frame_confidence_ > 0.0f) {
+            float mean = std::accumulate(pc.confidence.begin(),
+                                         pc.confidence.end(), 0.0f) /
+                         static_cast<float>(pc.confidence.size());
+            if (mean < min_frame_confidence_) {
+                failed = true;
+                ++rejected_frames_;
+            }
+        }
+        if (debug_) {
+            debug_->submit(frames_[i], pc.image, failed);
+        }
+        frames_[i].release();
+        if (failed) {
+            continue;
+        }
+
+        double z_val = z_[i];
+
+        size_t first = points_.size();
+        for (size_t j = 0; j < pc.coordinates.size(); ++j) {
+            float confidence = pc.confidence[j];
+            if (confidence < min_column_confidence_) {
+                continue;
+            }
+            double x = static_cast<double>(pc.coordinates[j].x);
+            double y = static_cast<double>(pc.coordinates[j].y);
+            points_.emplace_back(Eigen::Vector3d(x, z_val, y));
+            weights_.push_back(confidence);
+        }
+        estimator_.add_frame(
+            std::span<const Eigen::Vector3d>(points_).subspan(first),
+            std::span<const double>(weights_).subspan(first));
+
+        if (acq_interval_ && points_.size() >= static_cast<size_t>(interval_)) {
+            complete_ = true;
+        }
+    }
+}
+
+std::vector<Eigen::Vector3d>
+SurfaceAccumulator::finish(std::vector<double> *weights) {
+    collect();
+    std::vector<Eigen::Vector3d> pc_3d = std::move(points_);
+    if (weights) {
+        *weights = std::move(weights_);
+    }
+
+    points_.clear();
+    weights_.clear();
+    frames_.clear();
+    z_.clear();
+    pending_.clear();
+    collected_ = 0;
+    complete_ = false;
+    estimator_.reset();
+    return pc_3d;
+}
@@ -0,0 +1,83 @@
+#ifndef SURFACE_ACCUMULATOR_HPP
+#define SURFACE_ACCUMULATOR_HPP
+
+#include <Eigen/Dense>
+#include <future>
+#include <opencv2/opencv.hpp>
+#include <span>
+#include <vector>
+
+#include "frame_handle.hpp"
+#include "plane_fit.hpp"
+#include "process_img.hpp"
+
+class DebugWriter;
+class ThreadPool;
+
+// Builds the focus point cloud while frames are still being acquired.
+// submit() hands each frame to the thread pool as soon as it arrives, so by
+// the time the last one lands only its own detection is outstanding.
+// Frames carrying a B-scan index are placed at that position on the slow
+// axis; frames without one are assumed to be evenly spaced in arrival order.
+// collect() folds finished detections into the cloud in frame order and
+// updates a FramePlaneEstimator, so callers can decide mid-acquisition
+// whether more B-scans are needed. finish() collects the rest and returns
+// the cloud.
+class SurfaceAccumulator {
+  public:
+    SurfaceAccumulator(int interval, bool acq_interval = false,
+                       DebugWriter *debug = nullptr);
+    SurfaceAccumulator(int interval, bool acq_interval, DebugWriter *debug,
+                       ThreadPool &pool);
+
+    // Columns below `column` confidence are dropped; frames whose mean
+    // confidence is below `frame` are rejected like failed detections. Both
+    // default to 0, which keeps every point.
+    void set_confidence_thresholds(float column, float frame);
+
+    // Detect frames through detect_lines_tracked, keyed by B-scan index. The
+    // tracker must outlive every submitted detection.
+    void set_roi_tracker(DepthRoiTracker *tracker) { tracker_ = tracker; }
+
+    // Frames are shared with the worker, not copied.
+    void submit(const FrameHandle &frame);
+    // Catch-up for frames that piled up while the caller was busy: detects
+    // them together on the shared pool through detect_lines_batch, with the
+    // calling thread helping, and returns once they are ready to collect.
+    void submit_batch(std::span<const FrameHandle> frames);
+    std::size_t submitted() const { return frames_.size(); }
+
+    // Waits for every detection submitted so far and folds it in.
+    void collect();
+    const FramePlaneEstimator &estimator() const { return estimator_; }
+
+    // `weights`, if given, receives the confidence of every returned point.
+    // Resets the accumulator for the next acquisition.
+    std::vector<Eigen::Vector3d> finish(std::vector<double> *weights = nullptr);
+    // Low-confidence frames rejected since construction.
+    std::size_t rejected_frames() const { return rejected_frames_; }
+
+  private:
+    // Records `frame` and its slow-axis position; returns its B-scan index.
+    int place(const FrameHandle &frame);
+
+    int interval_;
+    bool acq_interval_;
+    DebugWriter *debug_;
+    ThreadPool &pool_;
+    DepthRoiTracker *tracker_ = nullptr;
+    float min_column_confidence_ = 0.0f;
+    float min_frame_confidence_ = 0.0f;
+    std::size_t rejected_frames_ = 0;
+    std::vector<FrameHandle> frames_;
+    // Slow-axis position of each submitted frame.
+    std::vector<double> z_;
+    std::vector<std::future<SegmentResult>> pending_;
+    std::size_t collected_ = 0;
+    bool complete_ = false;
+    std::vector<Eigen::Vector3d> points_;
+    std::vector<double> weights_;
+    FramePlaneEstimator estimator_;
+};
+
+#endif // SURFACE_ACCUMULATOR_HPP
@@ -1,6 +1,83 @@
+#include "background_model.hpp"
+#include "detector_context.hpp"
 #include "process_img.hpp"
 #include <ament_index_cpp/get_package_share_directory.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// The background with one bright, gently curved surface added. Every
+// column's full-frame peak lies on the surface, so a band around it must
+// reproduce the full-frame detection.
+static cv::Mat synthetic_bscan(const cv::Mat &bg_f) {
+    cv::Mat img;
+    bg_f.convertTo(img, CV_8U);
+    for (int x = 0; x < img.cols; ++x) {
+        double depth = img.rows * (0.4 + 0.1 * std::sin(x * 0.01));
+        for (int y = 0; y < img.rows; ++y) {
+            double d = (y - depth) / 3.0;
+            int v = img.at<std::uint8_t>(y, x) +
+                    cvRound(150.0 * std::exp(-0.5 * d * d));
+            img.at<std::uint8_t>(y, x) = cv::saturate_cast<std::uint8_t>(v);
+        }
+    }
+    return img;
+}
+
+// Banded detection with the tracker's band and full-frame reference must
+// give the full-frame depths and confidences.
+static bool banded_matches_full(const cv::Mat &img) {
+    DetectorContext context;
+    SegmentResult full;
+    context.process(img, full);
+
+    DepthRoiTracker tracker;
+    tracker.update(0, full, false, false);
+    DepthBand band;
+    if (!tracker.band(0, img.rows, img.cols, band)) {
+        std::cerr << "No band after a full frame" << std::endl;
+        return false;
+    }
+    SegmentResult banded;
+    context.process(img, banded, &band);
+
+    float depth_diff = 0.0f;
+    float confidence_diff = 0.0f;
+    for (size_t x = 0; x < full.coordinates.size(); ++x) {
+        depth_diff = std::max(
+            depth_diff,
+            std::abs(banded.coordinates[x].y - full.coordinates[x].y));
+        confidence_diff =
+            std::max(confidence_diff,
+                     std::abs(banded.confidence[x] - full.confidence[x]));
+    }
+    std::cout << "Banded vs full frame: max depth diff " << depth_diff
+              << " rows, max confidence diff " << confidence_diff
+              << std::endl;
+    return depth_diff <= 1e-3f && confidence_diff <= 1e-6f &&
+           tracker.locked(band, banded);
+}
+
+// detect_lines_batch must return what detect_lines gives for each frame,
+// in input order.
+static bool batch_matches_serial(const std::vector<cv::Mat> &frames) {
+    std::vector<SegmentResult> batch = detect_lines_batch(frames);
+    if (batch.size() != frames.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < frames.size(); ++i) {
+        SegmentResult serial = detect_lines(frames[i]);
+        if (batch[i].coordinates != serial.coordinates ||
+            batch[i].confidence != serial.confidence) {
+            std::cerr << "Batch result " << i << " differs" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
 int main(int argc, char **argv) {
     if (argc < 2) {
         std::cerr << "Usage: " << argv[0] << " <input.jpg> [output.jpg]"
@@ -17,8 +94,85 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    const std::string bg_path = BackgroundModel::default_path();
+    if (!BackgroundModel::instance().load(bg_path)) {
+        std::cerr << "Cannot open background " << bg_path << std::endl;
+        return 1;
+    }
+
+    if (!banded_matches_full(
+            synthetic_bscan(*BackgroundModel::instance().get()))) {
+        std::cerr << "Banded detection differs from full-frame detection"
+                  << std::endl;
+        return 1;
+    }
+
     SegmentResult result = detect_lines(inputImage);
 
+    cv::Mat flipped;
+    cv::flip(inputImage, flipped, 1);
+    if (!batch_matches_serial(
+            {inputImage, flipped,
+             synthetic_bscan(*BackgroundModel::instance().get())})) {
+        std::cerr << "Batch detection differs from detect_lines" << std::endl;
+        return 1;
+    }
+
+    const int runs = 50;
+    cv::Mat fused, reference;
+    cv::TickMeter fused_tm, reference_tm;
+    for (int i = 0; i < runs; ++i) {
+        fused_tm.start();
+        fused = spatialFilter(inputImage);
+        fused_tm.stop();
+        reference_tm.start();
+        reference = spatialFilterReference(inputImage);
+        reference_tm.stop();
+    }
+    const double filter_diff = cv::norm(fused, reference, cv::NORM_INF);
+    std::cout << "spatialFilter: fused " << fused_tm.getTimeMilli() / runs
+              << " ms, reference " << reference_tm.getTimeMilli() / runs
+              << " ms, max abs diff " << filter_diff << std::endl;
+    // The fused filter sums in a different order and rounds once at the
+    // end, which may move a pixel by one grey level but no more.
+    const double max_filter_diff = 1.0;
+    if (filter_diff > max_filter_diff) {
+        std::cerr << "Fused spatialFilter is more than " << max_filter_diff
+                  << " grey level off the reference" << std::endl;
+        return 1;
+    }
+
+    DetectorContext context;
+    SegmentResult reused;
+    cv::TickMeter context_tm;
+    DetectorContext::Stats first;
+    for (int i = 0; i < runs; ++i) {
+        context_tm.start();
+        context.process(inputImage, reused);
+        context_tm.stop();
+        if (i == 0) {
+            first = context.stats();
+        }
+    }
+    const DetectorContext::Stats &stats = context.stats();
+    std::cout << "DetectorContext: " << context_tm.getTimeMilli() / runs
+              << " ms, buffer allocations " << stats.buffer_allocations
+              << " (first frame " << first.buffer_allocations << ")";
+    if (stats.heap_counted) {
+        std::cout << ", heap allocations " << stats.heap_allocations
+                  << " (first frame " << first.heap_allocations << ")";
+    } else {
+        std::cout << ", heap allocations not counted";
+    }
+    std::cout << std::endl;
+    // Every frame after the first reuses the buffers of the one before.
+    if (stats.buffer_allocations != first.buffer_allocations ||
+        stats.heap_allocations != first.heap_allocations) {
+        std::cerr << "DetectorContext allocated on a steady-state frame"
+                  << std::endl;
+        return 1;
+    }
+
     if (!cv::imwrite(outputFile, result.image)) {
         std::cerr << "Could not save result to " << outputFile << std::endl;
         return 1;
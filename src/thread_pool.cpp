@@ -0,0 +1,147 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <latch>
+
+namespace {
+
+// Pool and queue index of the current thread, if it is a pool worker.
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local unsigned current_index = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned threads) {
+    threads = std::max(1u, threads);
+    queues_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    threads_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        threads_.emplace_back([this, i]() { worker_loop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stop_ = true;
+    }
+    sleep_cv_.notify_all();
+    for (std::thread &t : threads_) {
+        t.join();
+    }
+}
+
+ThreadPool &ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::enqueue(Task task) {
+    unsigned index = (current_pool == this)
+                         ? current_index
+                         : next_queue_.fetch_add(1) % queues_.size();
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        pending_.fetch_add(1);
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    sleep_cv_.notify_one();
+}
+
+bool ThreadPool::try_pop(unsigned index, Task &task) {
+    Queue &q = *queues_[index];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) {
+        return false;
+    }
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::try_steal(unsigned index, Task &task) {
+    const unsigned n = static_cast<unsigned>(queues_.size());
+    for (unsigned k = 1; k <= n; ++k) {
+        Queue &q = *queues_[(index + k) % n];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty()) {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::run_one(unsigned index) {
+    Task task;
+    if (!try_pop(index, task) && !try_steal(index, task)) {
+        return false;
+    }
+    pending_.fetch_sub(1);
+    task();
+    return true;
+}
+
+void ThreadPool::worker_loop(unsigned index) {
+    current_pool = this;
+    current_index = index;
+    while (true) {
+        if (run_one(index)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleep_cv_.wait(lock, [this]() { return stop_ || pending_.load() > 0; });
+        if (stop_ && pending_.load() <= 0) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::parallel_for(std::size_t n,
+                              const std::function<void(std::size_t)> &fn) {
+    if (n == 0) {
+        return;
+    }
+    // Owned jointly with the tasks: the last task can still be inside
+    // count_down() after wait() has returned and this frame is gone.
+    struct State {
+        explicit State(std::size_t n) : done(static_cast<std::ptrdiff_t>(n)) {}
+        std::latch done;
+        std::mutex error_mutex;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>(n);
+
+    // fn itself is only used before count_down(), so it can stay borrowed.
+    for (std::size_t i = 0; i < n; ++i) {
+        enqueue([state, &fn, i]() {
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state->error_mutex);
+                if (!state->error) {
+                    state->error = std::current_exception();
+                }
+            }
+            state->done.count_down();
+        });
+    }
+
+    unsigned index = (current_pool == this) ? current_index : 0;
+    while (!state->done.try_wait() && run_one(index)) {
+    }
+    state->done.wait();
+
+    // Every task has counted down, so nothing writes the error any more.
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Work-stealing pool for per-frame image processing. Every worker owns a
+// deque: it pops its own work from the back and steals from the front of the
+// others when it runs dry. Tasks submitted from a worker stay on that worker's
+// deque, tasks from other threads are spread round-robin.
+class ThreadPool {
+  public:
+    explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Process-wide pool sized to the machine.
+    static ThreadPool &shared();
+
+    unsigned size() const { return static_cast<unsigned>(threads_.size()); }
+
+    template <class F>
+    auto submit(F &&fn) -> std::future<std::invoke_result_t<F>> {
+        using R = std::invoke_result_t<F>;
+        auto task =
+            std::make_shared<std::packaged_task<R()>>(std::forward<F>(fn));
+        std::future<R> result = task->get_future();
+        enqueue([task]() { (*task)(); });
+        return result;
+    }
+
+    // Runs fn(0) .. fn(n - 1) on the pool and returns once all are done. The
+    // calling thread helps execute queued tasks while it waits, so this is
+    // safe to call from inside a pool task. The first exception thrown by fn
+    // is rethrown here.
+    void parallel_for(std::size_t n,
+                      const std::function<void(std::size_t)> &fn);
+
+  private:
+    using Task = std::function<void()>;
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void enqueue(Task task);
+    bool try_pop(unsigned index, Task &task);
+    bool try_steal(unsigned index, Task &task);
+    bool run_one(unsigned index);
+    void worker_loop(unsigned index);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    std::atomic<unsigned> next_queue_{0};
+    std::atomic<std::ptrdiff_t> pending_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    bool stop_ = false;
+};
+
+#endif // THREAD_POOL_HPP